@@ -0,0 +1,92 @@
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include <fmt/core.h>
+#include <opencv2/core.hpp>
+
+#include "camera/rotation.hpp"
+
+namespace
+{
+
+static constexpr int _rows = 3648;
+static constexpr int _cols = 5472;
+static constexpr size_t _iterations = 50;
+
+template<typename F>
+[[nodiscard]]
+static inline double _median_milliseconds(F&& function)
+{
+	std::vector<double> samples;
+	samples.reserve(_iterations);
+	for (size_t i = 0; i < _iterations; ++i)
+	{
+		const auto begin = std::chrono::steady_clock::now();
+		function();
+		const auto end = std::chrono::steady_clock::now();
+		samples.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+	}
+	std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+	return samples[samples.size() / 2];
+}
+
+static inline void _transpose_flip(const cv::Mat& image, cv::Mat& output, bool clockwise)
+{
+	cv::transpose(image, output);
+	cv::flip(output, output, clockwise ? 1 : 0);
+}
+
+static inline void _single_pass(const cv::Mat& image, cv::Mat& output, bool clockwise)
+{
+	output.create(image.cols, image.rows, image.type());
+	utilities::camera::_utils::rotate_90(
+		image.data,
+		image.step[0],
+		output.data,
+		output.step[0],
+		image.rows,
+		image.cols,
+		image.channels(),
+		clockwise
+	);
+}
+
+// returns false if both implementations disagree
+[[nodiscard]]
+static inline bool _run(int type, bool clockwise)
+{
+	cv::Mat image(_rows, _cols, type), expected, actual;
+	cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(256));
+
+	const auto baseline = _median_milliseconds([&] { _transpose_flip(image, expected, clockwise); });
+	const auto current = _median_milliseconds([&] { _single_pass(image, actual, clockwise); });
+	const bool equal = cv::norm(expected, actual, cv::NORM_INF) == 0;
+
+	fmt::print(
+		"{:<6} {:<18} transpose + flip {:8.2f} ms, single pass {:8.2f} ms, x{:.2f}{}\n",
+		type == CV_8UC1 ? "8UC1" : "8UC3",
+		clockwise ? "clockwise" : "counter-clockwise",
+		baseline,
+		current,
+		baseline / current,
+		equal ? "" : " MISMATCH"
+	);
+	return equal;
+}
+
+}
+
+int main()
+{
+	fmt::print("{} x {}, median of {} iterations\n", _cols, _rows, _iterations);
+
+	bool ok = true;
+	for (auto type : { CV_8UC1, CV_8UC3 })
+		for (auto clockwise : { true, false })
+			ok = _run(type, clockwise) && ok;
+	return ok ? 0 : 1;
+}
@@ -2,13 +2,27 @@
 #define __UTILITIES_CAMERA_BASE_HPP__
 
 #include <cstddef>
+#include <cstdint>
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <functional>
+#include <stop_token>
 #include <string>
 #include <system_error>
 #include <utility>
 
 #include <opencv2/core.hpp>
 
+#include "utilities/camera/event_loop.hpp"
+#include "utilities/camera/parameters.hpp"
+#include "utilities/camera/pool.hpp"
+#include "utilities/camera/ring.hpp"
+#include "utilities/camera/statistics.hpp"
+#include "utilities/camera/thread.hpp"
+
 namespace utilities::camera::base
 {
 
@@ -20,21 +34,120 @@ enum class brand
 	HUARAY
 };
 
+enum class pixel_layout
+{
+	MONO,
+	BGR,
+	BAYER_BG,
+	BAYER_GB,
+	BAYER_GR,
+	BAYER_RG
+};
+
+// Describes the pixels of a frame; bayer patterns are named after the first two pixels of the first row.
+struct pixel_format final
+{
+	pixel_layout layout;
+	// significant bits per sample, stored in 8-bit elements up to 8 bits and in 16-bit elements otherwise
+	uint8_t depth;
+	// two samples in three bytes, as in the GigE Vision Mono10Packed and Mono12Packed formats
+	bool packed;
+
+	[[nodiscard]]
+	inline constexpr bool operator==(const pixel_format&) const noexcept = default;
+
+	// false for the 8-bit mono and BGR frames delivered outside of raw mode
+	[[nodiscard]]
+	inline constexpr bool raw() const noexcept
+	{
+		return depth != 8 || packed || (layout != pixel_layout::MONO && layout != pixel_layout::BGR);
+	}
+};
+
 struct frame final
 {
+	// the content, then its halves down to a quarter
+	static constexpr size_t pyramid_levels = 3;
+
 	size_t id;
 	cv::Mat content;
+	pixel_format format;
+	// identifier given by the SDK, GigE Vision block ids or USB3 Vision frame numbers alike
+	uint64_t block_id;
+	// time of exposure in device ticks, see the timestamp tick frequency of the device
+	uint64_t device_timestamp;
+	// time of arrival in the SDK callback
+	std::chrono::steady_clock::time_point host_timestamp;
+	// number of frames lost by the camera or the transport right before this one, judging by the block ids
+	size_t gap;
+	// reduced levels of the content, shared by every consumer of the frame, empty unless built by the device
+	std::array<cv::Mat, pyramid_levels - 1> pyramid;
 
-	inline frame() noexcept : id(0), content {} {}
+	inline frame() noexcept :
+		id(0),
+		content {},
+		format { pixel_layout::MONO, 8, false },
+		block_id(0),
+		device_timestamp(0),
+		host_timestamp {},
+		gap(0),
+		pyramid {}
+	{}
 
-	inline frame(size_t id, cv::Mat content) noexcept : id(id), content(std::move(content)) {}
+	inline frame(size_t id, cv::Mat content) noexcept :
+		id(id),
+		content(std::move(content)),
+		format { this->content.channels() == 3 ? pixel_layout::BGR : pixel_layout::MONO, 8, false },
+		block_id(0),
+		device_timestamp(0),
+		host_timestamp {},
+		gap(0),
+		pyramid {}
+	{}
+
+	inline frame(size_t id, cv::Mat content, const pixel_format& format) noexcept :
+		id(id),
+		content(std::move(content)),
+		format(format),
+		block_id(0),
+		device_timestamp(0),
+		host_timestamp {},
+		gap(0),
+		pyramid {}
+	{}
 
 	frame(const frame&) = delete;
 
 	inline frame(frame&&) noexcept = default;
 
+	frame& operator=(const frame&) = delete;
+
+	inline frame& operator=(frame&&) noexcept = default;
+
 	[[nodiscard]]
 	inline operator bool() const noexcept { return id; }
+
+	// 0 for the content, each level halving the previous one; empty if not built
+	[[nodiscard]]
+	inline const cv::Mat& level(size_t index) const noexcept
+	{
+		return index ? pyramid[index - 1] : content;
+	}
+
+	// the smallest level built still covering the size, to be scaled down from by consumers resizing anyway
+	[[nodiscard]]
+	inline size_t level_for(const cv::Size& size) const noexcept
+	{
+		size_t ret = 0;
+		for (size_t i = 1; i < pyramid_levels; ++i)
+		{
+			const auto& current = pyramid[i - 1];
+			if (current.empty() || current.cols < size.width || current.rows < size.height)
+				break;
+			ret = i;
+		}
+		return ret;
+	}
 };
 
 enum class rotation_direction
@@ -45,6 +158,13 @@ enum class rotation_direction
 	COUNTER_CLOCKWISE_90
 };
 
+class frame_awaiter;
+
+class frame_subscription;
+
+// called with either an error or a frame, from the event loop, must not throw
+using frame_handler = std::function<void(const std::error_code& ec, frame frame)>;
+
 struct device
 {
 	inline device() noexcept = default;
@@ -55,11 +175,41 @@ struct device
 
 	inline virtual ~device() noexcept = default;
 
+	// thread delivering the frames, the SDK callback one or the simulation one
+	[[nodiscard]]
+	virtual const thread_affinity& acquisition_thread() const = 0;
+
+	// must not be called while started, failures to bind are reported by next_image
+	virtual void acquisition_thread(thread_affinity affinity) = 0;
+
+	// stops the acquisition once if started, and rolls every write back in reverse order if any fails
+	[[nodiscard]]
+	virtual parameter_report apply(const parameter_set& parameters) = 0;
+
 	[[nodiscard]]
 	virtual brand brand() const = 0;
 
 	virtual void close() = 0;
 
+	// set once the SDK reports the device lost, until it is reconnected
+	[[nodiscard]]
+	virtual bool disconnected() const = 0;
+
+	// by the queue since it was last sized, left alone by reset_statistics
+	[[nodiscard]]
+	virtual size_t dropped_frames() const = 0;
+
+	// hands every frame to the handler on the event loop until the subscription is destroyed
+	[[nodiscard]]
+	inline frame_subscription listen(event_loop& loop, frame_handler handler);
+
+	// notified from the acquisition thread after each frame is queued, must not be called from within the listener
+	virtual void listener(ring_listener *listener) = 0;
+
+	// co_await resumes on the event loop, throwing on failure
+	[[nodiscard]]
+	inline frame_awaiter next_frame(event_loop& loop);
+
 	[[nodiscard]]
 	virtual frame next_image(std::error_code& ec) = 0;
 
@@ -73,8 +223,67 @@ struct device
 		return ret;
 	}
 
+	// returns an empty frame if nothing arrives before the timeout or the stop request
+	[[nodiscard]]
+	virtual frame next_image(
+		std::error_code& ec,
+		std::stop_token token,
+		const std::chrono::nanoseconds& timeout
+	) = 0;
+
+	[[nodiscard]]
+	inline virtual frame next_image(std::stop_token token, const std::chrono::nanoseconds& timeout) final
+	{
+		std::error_code ec;
+		auto ret = next_image(ec, std::move(token), timeout);
+		if (ec)
+			throw std::system_error(ec);
+		return ret;
+	}
+
+	template<typename Rep, typename Period>
+	[[nodiscard]]
+	inline frame next_image(std::stop_token token, const std::chrono::duration<Rep, Period>& timeout)
+	{
+		return next_image(std::move(token), std::chrono::duration_cast<std::chrono::nanoseconds>(timeout));
+	}
+
+	template<typename Rep, typename Period>
+	[[nodiscard]]
+	inline frame wait_next_image(const std::chrono::duration<Rep, Period>& timeout)
+	{
+		return next_image(std::stop_token {}, std::chrono::duration_cast<std::chrono::nanoseconds>(timeout));
+	}
+
 	virtual void open() = 0;
 
+	[[nodiscard]]
+	virtual frame_pool& pool() = 0;
+
+	// number of pyramid levels built on the acquisition thread, the content alone being one
+	[[nodiscard]]
+	virtual size_t pyramid() const = 0;
+
+	// from 1 to frame::pyramid_levels, must not be called while subscribed; raw frames are never reduced
+	virtual void pyramid(size_t levels) = 0;
+
+	// must not be called while subscribed
+	virtual void queue(size_t capacity, overflow_policy policy) = 0;
+
+	// frames are delivered as sent by the sensor, neither converted nor rotated, see develop
+	[[nodiscard]]
+	virtual bool raw() const = 0;
+
+	// must not be called while subscribed
+	virtual void raw(bool enable) = 0;
+
+	// opens the device anew, looked up again by its serial, once stopped and unsubscribed; throws if it is not back
+	// the settings held by the object are kept, the parameters of the device are as it powered up
+	virtual void reconnect() = 0;
+
+	// the dropped count of the statistics starting over too
+	virtual void reset_statistics() = 0;
+
 	[[nodiscard]]
 	virtual rotation_direction rotation() const = 0;
 
@@ -85,6 +294,10 @@ struct device
 
 	virtual void start() = 0;
 
+	// counters of the acquisition pipeline since the device was created or its statistics reset
+	[[nodiscard]]
+	virtual device_statistics::snapshot statistics() const = 0;
+
 	virtual void stop() = 0;
 
 	virtual void subscribe() = 0;
@@ -92,6 +305,83 @@ struct device
 	virtual void unsubscribe() = 0;
 };
 
+// Awaits the next frame of a device without blocking, the coroutine being resumed on an event loop.
+// A device must neither be awaited by several coroutines at once nor polled with next_image meanwhile.
+// The suspended coroutine may be destroyed, which detaches it, but not while its loop is resuming it.
+class frame_awaiter final : private ring_listener, private event_loop::task
+{
+	device& _device;
+	event_loop& _loop;
+	// from the suspension until the loop finds a frame, the awaiter being registered with the device and the loop
+	std::coroutine_handle<> _handle;
+	frame _frame;
+	std::error_code _ec;
+	// notifications not yet looked at by the loop, the one posting it being the first
+	std::atomic<size_t> _pending;
+
+	virtual void pushed() noexcept override;
+
+	virtual void run() noexcept override;
+public:
+	frame_awaiter(device& device, event_loop& loop) noexcept;
+
+	frame_awaiter(const frame_awaiter&) = delete;
+
+	frame_awaiter(frame_awaiter&&) = delete;
+
+	~frame_awaiter() noexcept;
+
+	frame_awaiter& operator=(const frame_awaiter&) = delete;
+
+	frame_awaiter& operator=(frame_awaiter&&) = delete;
+
+	[[nodiscard]]
+	bool await_ready();
+
+	void await_suspend(std::coroutine_handle<> handle);
+
+	[[nodiscard]]
+	frame await_resume();
+};
+
+// Hands every frame of a device to a handler run on an event loop.
+// May be destroyed from any thread, its loop's ones included, but not from within its own handler.
+class frame_subscription final : private ring_listener, private event_loop::task
+{
+	device& _device;
+	event_loop& _loop;
+	frame_handler _handler;
+	std::atomic<size_t> _pending;
+
+	virtual void pushed() noexcept override;
+
+	virtual void run() noexcept override;
+public:
+	frame_subscription(device& device, event_loop& loop, frame_handler handler);
+
+	frame_subscription(const frame_subscription&) = delete;
+
+	frame_subscription(frame_subscription&&) = delete;
+
+	~frame_subscription() noexcept;
+
+	frame_subscription& operator=(const frame_subscription&) = delete;
+
+	frame_subscription& operator=(frame_subscription&&) = delete;
+};
+
+[[nodiscard]]
+inline frame_subscription device::listen(event_loop& loop, frame_handler handler)
+{
+	return { *this, loop, std::move(handler) };
+}
+
+[[nodiscard]]
+inline frame_awaiter device::next_frame(event_loop& loop)
+{
+	return { *this, loop };
+}
+
 }
 
 #endif
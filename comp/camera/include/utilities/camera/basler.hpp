@@ -5,9 +5,9 @@
 #include <cstdint>
 
 #include <chrono>
-#include <list>
 #include <memory>
-#include <mutex>
+#include <optional>
+#include <stop_token>
 #include <string>
 #include <string_view>
 #include <system_error>
@@ -18,6 +18,9 @@
 #include <pylon/PylonIncludes.h>
 
 #include "utilities/camera/base.hpp"
+#include "utilities/camera/pool.hpp"
+#include "utilities/camera/pyramid.hpp"
+#include "utilities/camera/ring.hpp"
 
 namespace utilities::camera
 {
@@ -48,21 +51,77 @@ private:
 	{
 		Pylon::CImageFormatConverter _converter;
 		bool _colour;
+		bool _raw;
 		base::rotation_direction _rotation;
-		std::mutex _lock;
-		std::list<cv::Mat> _images;
+		cv::Mat _converted;
+		frame_pool _buffers;
+		ring<base::frame> _images;
 		size_t _counter;
+		std::optional<uint64_t> _last_block_id;
+		device_statistics _statistics;
+		thread_binder _binder;
+		pyramid_builder _pyramid;
+		bool _zero_copy;
 	public:
 		image_listener(bool colour);
 
+		[[nodiscard]]
+		inline thread_binder& binder();
+
+		[[nodiscard]]
+		inline const thread_binder& binder() const;
+
+		[[nodiscard]]
+		inline frame_pool& buffers();
+
+		[[nodiscard]]
+		inline pyramid_builder& builder();
+
+		[[nodiscard]]
+		inline const pyramid_builder& builder() const;
+
+		[[nodiscard]]
+		inline size_t capacity() const;
+
+		[[nodiscard]]
+		inline size_t dropped() const;
+
+		inline void listener(ring_listener *listener);
+
 		[[nodiscard]]
 		inline base::frame next(std::error_code& ec);
 
+		[[nodiscard]]
+		inline base::frame next(std::error_code& ec, std::stop_token token, const std::chrono::nanoseconds& timeout);
+
+		inline void queue(size_t capacity, overflow_policy policy);
+
+		[[nodiscard]]
+		inline bool raw() const;
+
+		inline void raw(bool enable);
+
+		// sizes the pool for the current geometry and pixel format, which may have changed since the last start
+		inline void reserve(Pylon::CBaslerUniversalInstantCamera& camera);
+
+		inline void reset_statistics();
+
 		[[nodiscard]]
 		inline base::rotation_direction rotation() const;
 
 		inline void rotation(base::rotation_direction direction);
 
+		[[nodiscard]]
+		inline device_statistics::snapshot statistics() const;
+
+		// set around the stop of the grab, see ring::stopping
+		inline void stopping(bool stopping);
+
+		[[nodiscard]]
+		inline bool zero_copy() const;
+
+		inline void zero_copy(bool enable);
+
 		virtual void OnImageEventHandlerRegistered(Pylon::CBaslerUniversalInstantCamera& camera) override;
 
 		virtual void OnImageGrabbed(
@@ -87,6 +146,14 @@ public:
 
 	// base::device
 
+	[[nodiscard]]
+	virtual const thread_affinity& acquisition_thread() const override;
+
+	virtual void acquisition_thread(thread_affinity affinity) override;
+
+	[[nodiscard]]
+	virtual parameter_report apply(const parameter_set& parameters) override;
+
 	[[nodiscard]]
 	inline virtual base::brand brand() const override
 	{
@@ -95,11 +162,47 @@ public:
 
 	virtual void close() override;
 
+	[[nodiscard]]
+	virtual bool disconnected() const override;
+
+	[[nodiscard]]
+	virtual size_t dropped_frames() const override;
+
+	virtual void listener(ring_listener *listener) override;
+
+	using base::device::next_image;
+
 	[[nodiscard]]
 	virtual base::frame next_image(std::error_code& ec) override;
 
+	[[nodiscard]]
+	virtual base::frame next_image(
+		std::error_code& ec,
+		std::stop_token token,
+		const std::chrono::nanoseconds& timeout
+	) override;
+
 	virtual void open() override;
 
+	[[nodiscard]]
+	virtual frame_pool& pool() override;
+
+	[[nodiscard]]
+	virtual size_t pyramid() const override;
+
+	virtual void pyramid(size_t levels) override;
+
+	virtual void queue(size_t capacity, overflow_policy policy) override;
+
+	[[nodiscard]]
+	virtual bool raw() const override;
+
+	virtual void raw(bool enable) override;
+
+	virtual void reconnect() override;
+
+	virtual void reset_statistics() override;
+
 	[[nodiscard]]
 	virtual base::rotation_direction rotation() const override;
 
@@ -110,6 +213,9 @@ public:
 
 	virtual void start() override;
 
+	[[nodiscard]]
+	virtual device_statistics::snapshot statistics() const override;
+
 	virtual void stop() override;
 
 	virtual void subscribe() override;
@@ -182,6 +288,30 @@ public:
 	{
 		return set_manual_trigger_line_source(line, std::chrono::duration_cast<std::chrono::duration<double, std::micro>>(delay));
 	}
+
+	// zero copy
+
+	[[nodiscard]]
+	bool zero_copy() const;
+
+	// raw or unrotated frames already in the output format keep their grab buffer until released, takes effect on start
+	void zero_copy(bool enable);
+
+	// sensor window, not to be changed while started
+
+	[[nodiscard]]
+	bool roi(cv::Rect& roi);
+
+	// binning and decimation reset the window on most sensors, hence come first
+	[[nodiscard]]
+	bool set_binning(size_t horizontal, size_t vertical);
+
+	[[nodiscard]]
+	bool set_decimation(size_t horizontal, size_t vertical);
+
+	// in binned and decimated pixels, widened to the increments of the sensor, empty meaning the whole sensor
+	[[nodiscard]]
+	bool set_roi(const cv::Rect& roi);
 };
 
 }
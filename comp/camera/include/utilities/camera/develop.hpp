@@ -0,0 +1,28 @@
+#ifndef __UTILITIES_CAMERA_DEVELOP_HPP__
+#define __UTILITIES_CAMERA_DEVELOP_HPP__
+
+#include <opencv2/core.hpp>
+
+#include "utilities/camera/base.hpp"
+
+namespace utilities::camera
+{
+
+// Converts a frame of any format into an 8-bit BGR or mono image, then rotates it.
+// The region of interest is given in sensor coordinates, before the rotation; an empty one selects the whole frame.
+// Meant to run on the consumer side, off the callback threads of the SDKs.
+void develop(
+	const base::frame& frame,
+	cv::Mat& output,
+	bool colour,
+	base::rotation_direction rotation = base::rotation_direction::ORIGINAL,
+	const cv::Rect& roi = {}
+);
+
+// Expands the samples of a frame into one 8-bit (depth of 8) or 16-bit element each, keeping the bayer mosaic.
+// The output shares the pixels of the frame unless they are packed.
+void unpack(const base::frame& frame, cv::Mat& output, const cv::Rect& roi = {});
+
+}
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef __UTILITIES_CAMERA_DISCOVER_HPP__
+#define __UTILITIES_CAMERA_DISCOVER_HPP__
+
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "utilities/camera/base.hpp"
+#include "utilities/camera/parameters.hpp"
+
+namespace utilities::camera
+{
+
+struct discovery final
+{
+	// in the order of the requested serials if any, otherwise grouped by SDK
+	std::vector<std::unique_ptr<base::device>> devices;
+	// SDKs that failed to enumerate, fake devices being reported as UNKNOWN
+	std::vector<std::pair<base::brand, std::exception_ptr>> failures;
+};
+
+// Enumerates the devices of every SDK, over every transport layer, concurrently.
+// Fake devices are only looked for when their base directory is given.
+[[nodiscard]]
+discovery discover(
+	const std::vector<std::string>& serials,
+	bool colour,
+	const std::filesystem::path& fake_base = {},
+	const std::chrono::nanoseconds& fake_interval = std::chrono::milliseconds(40)
+);
+
+// Runs the operation on every device concurrently and returns the failure of each device, null on success.
+[[nodiscard]]
+std::vector<std::exception_ptr> for_each_device(
+	std::vector<std::unique_ptr<base::device>>& devices,
+	const std::function<void(base::device&)>& operation
+);
+
+[[nodiscard]]
+std::vector<std::exception_ptr> open_all(std::vector<std::unique_ptr<base::device>>& devices);
+
+// subscribes then starts every device
+[[nodiscard]]
+std::vector<std::exception_ptr> start_all(std::vector<std::unique_ptr<base::device>>& devices);
+
+// stops then unsubscribes every device
+[[nodiscard]]
+std::vector<std::exception_ptr> stop_all(std::vector<std::unique_ptr<base::device>>& devices);
+
+[[nodiscard]]
+std::vector<std::exception_ptr> close_all(std::vector<std::unique_ptr<base::device>>& devices);
+
+// applies the same parameters to every device concurrently, each report matching the device at the same index
+[[nodiscard]]
+std::vector<std::exception_ptr> apply_all(
+	std::vector<std::unique_ptr<base::device>>& devices,
+	const parameter_set& parameters,
+	std::vector<parameter_report>& reports
+);
+
+}
+
+#endif
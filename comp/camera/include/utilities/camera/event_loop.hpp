@@ -0,0 +1,73 @@
+#ifndef __UTILITIES_CAMERA_EVENT_LOOP_HPP__
+#define __UTILITIES_CAMERA_EVENT_LOOP_HPP__
+
+#include <cstddef>
+
+#include <condition_variable>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace utilities::camera
+{
+
+// Runs the work posted by the acquisition threads of many devices on a few threads of ours.
+// Posting never allocates once the queue has grown to the number of tasks in flight.
+class event_loop final
+{
+public:
+	class task
+	{
+	public:
+		virtual void run() noexcept = 0;
+	protected:
+		inline ~task() noexcept = default;
+	};
+private:
+	mutable std::mutex _lock;
+	std::condition_variable_any _available;
+	// circular, its size being a power of two
+	std::vector<task *> _queue;
+	size_t _head;
+	size_t _count;
+	// one entry per thread inside a run, waited for by cancel
+	std::vector<std::pair<task *, std::thread::id>> _running;
+	std::condition_variable _finished;
+	size_t _cancelling;
+
+	void _execute(task *task) noexcept;
+
+	// must be called with the lock held
+	[[nodiscard]]
+	task *_take() noexcept;
+public:
+	event_loop();
+
+	event_loop(const event_loop&) = delete;
+
+	event_loop(event_loop&&) = delete;
+
+	event_loop& operator=(const event_loop&) = delete;
+
+	event_loop& operator=(event_loop&&) = delete;
+
+	// removes the task from the queue, and waits for the runs already started on other threads to return
+	void cancel(task *task);
+
+	[[nodiscard]]
+	size_t pending() const;
+
+	// runs the tasks already queued without waiting and returns their number
+	size_t poll();
+
+	void post(task *task);
+
+	// runs tasks until a stop is requested, from as many threads as wanted
+	void run(std::stop_token token);
+};
+
+}
+
+#endif
@@ -6,29 +6,63 @@
 
 #include <chrono>
 #include <filesystem>
+#include <future>
 #include <memory>
-#include <mutex>
+#include <optional>
 #include <stop_token>
+#include <string>
 #include <thread>
 #include <vector>
 
 #include <opencv2/core.hpp>
 
 #include "utilities/camera/base.hpp"
+#include "utilities/camera/pool.hpp"
+#include "utilities/camera/pyramid.hpp"
+#include "utilities/camera/ring.hpp"
 
 namespace utilities::camera
 {
 
 class fake final : public base::device
 {
+public:
+	enum class loading
+	{
+		// every image is decoded once, in parallel, before the constructor returns
+		EAGER,
+		// as EAGER, but on a background thread waited for on subscribe or start
+		BACKGROUND,
+		// every frame decodes its image again, keeping only the paths in memory
+		LAZY
+	};
+private:
+	std::vector<std::filesystem::path> _paths;
+	// empty when loaded lazily
 	std::vector<cv::Mat> _pool;
+	std::future<void> _loading;
+	std::vector<cv::Mat> _rotated;
+	base::rotation_direction _rotated_direction;
+	bool _colour;
 	std::string _serial;
+	bool _raw;
 	base::rotation_direction _rotation;
+	cv::Size _binning;
+	cv::Size _decimation;
+	cv::Rect _roi;
 	size_t _index;
-	std::chrono::milliseconds _interval;
-	std::mutex _lock;
-	std::list<cv::Mat> _images;
+	std::chrono::nanoseconds _interval;
+	std::chrono::nanoseconds _jitter;
+	uint64_t _seed;
+	frame_pool _buffers;
+	ring<base::frame> _images;
 	size_t _counter;
+	device_statistics _statistics;
+	thread_binder _binder;
+	pyramid_builder _pyramid;
+	bool _zero_copy;
+	std::optional<size_t> _trigger_line;
+	std::chrono::duration<double, std::micro> _trigger_delay;
 
 	std::stop_source _stop;
 	std::thread _simulation;
@@ -37,23 +71,51 @@ class fake final : public base::device
 		const std::filesystem::path& base,
 		std::string serial,
 		bool colour,
-		std::chrono::milliseconds interval
+		const std::chrono::nanoseconds& interval,
+		loading mode,
+		const std::filesystem::path& cache_directory
 	);
 
+	void _wait_loaded();
+
+	[[nodiscard]]
+	bool _windowed() const noexcept;
+
+	// emulates the binning, decimation and window of a sensor
+	[[nodiscard]]
+	cv::Mat _window(const cv::Mat& image) const;
+
+	// the integer nodes of a sensor window, the only ones emulated
+	[[nodiscard]]
+	int *_node(const std::string& name) noexcept;
+
+	void _emit(uint64_t block_id, size_t gap, std::chrono::steady_clock::time_point exposure);
+
 	void _simulate(std::stop_token token);
 public:
+	// decoded images may be cached as files keyed by a hash of their sources, which lazy loading ignores
 	[[nodiscard]]
 	static std::vector<std::unique_ptr<fake>> find(
 		const std::filesystem::path& base,
 		std::vector<std::string> serials,
 		bool colour,
-		const std::chrono::milliseconds& interval
+		const std::chrono::nanoseconds& interval,
+		loading mode = loading::BACKGROUND,
+		const std::filesystem::path& cache_directory = {}
 	);
 
 	virtual ~fake() noexcept override;
 
 	// base::device
 
+	[[nodiscard]]
+	virtual const thread_affinity& acquisition_thread() const override;
+
+	virtual void acquisition_thread(thread_affinity affinity) override;
+
+	[[nodiscard]]
+	virtual parameter_report apply(const parameter_set& parameters) override;
+
 	[[nodiscard]]
 	inline virtual base::brand brand() const override
 	{
@@ -62,11 +124,52 @@ public:
 
 	inline virtual void close() override {}
 
+	// a simulation is never lost
+	[[nodiscard]]
+	inline virtual bool disconnected() const override
+	{
+		return false;
+	}
+
+	[[nodiscard]]
+	virtual size_t dropped_frames() const override;
+
+	virtual void listener(ring_listener *listener) override;
+
+	using base::device::next_image;
+
 	[[nodiscard]]
 	virtual base::frame next_image(std::error_code& ec) override;
 
+	[[nodiscard]]
+	virtual base::frame next_image(
+		std::error_code& ec,
+		std::stop_token token,
+		const std::chrono::nanoseconds& timeout
+	) override;
+
 	inline virtual void open() override {}
 
+	[[nodiscard]]
+	virtual frame_pool& pool() override;
+
+	[[nodiscard]]
+	virtual size_t pyramid() const override;
+
+	virtual void pyramid(size_t levels) override;
+
+	virtual void queue(size_t capacity, overflow_policy policy) override;
+
+	// colour images are delivered as bayer RG 8 mosaics, mono ones unchanged
+	[[nodiscard]]
+	virtual bool raw() const override;
+
+	virtual void raw(bool enable) override;
+
+	inline virtual void reconnect() override {}
+
+	virtual void reset_statistics() override;
+
 	[[nodiscard]]
 	virtual base::rotation_direction rotation() const override;
 
@@ -77,11 +180,67 @@ public:
 
 	virtual void start() override;
 
+	[[nodiscard]]
+	virtual device_statistics::snapshot statistics() const override;
+
 	virtual void stop() override;
 
 	virtual void subscribe() override;
 
 	inline virtual void unsubscribe() override {}
+
+	// manual trigger
+
+	// frames are produced on pulses of a simulated line shared by every fake device, instead of periodically
+	[[nodiscard]]
+	bool set_manual_trigger_line_source(size_t line, const std::chrono::duration<double, std::micro>& delay);
+
+	template<typename Rep, typename Period>
+	[[nodiscard]]
+	inline bool set_manual_trigger_line_source(size_t line, const std::chrono::duration<Rep, Period>& delay)
+	{
+		return set_manual_trigger_line_source(line, std::chrono::duration_cast<std::chrono::duration<double, std::micro>>(delay));
+	}
+
+	static void trigger(size_t line);
+
+	// replay
+
+	[[nodiscard]]
+	std::chrono::nanoseconds interval() const;
+
+	// frames follow a fixed schedule from the start, a zero interval produces them as fast as the queue accepts them,
+	// yielding between frames unless the queue blocks
+	void interval(const std::chrono::nanoseconds& interval);
+
+	// shifts every frame of the schedule by up to the amplitude either way, identically for a given seed,
+	// the amplitude being kept below half the interval so that timestamps stay increasing
+	void jitter(const std::chrono::nanoseconds& amplitude, uint64_t seed);
+
+	// zero copy
+
+	[[nodiscard]]
+	bool zero_copy() const;
+
+	// frames share storage with the loaded images and must be treated as read-only, rotations are prepared on subscribe
+	void zero_copy(bool enable);
+
+	// sensor window, emulated in software on every frame, not to be changed while started
+
+	// empty for the whole sensor
+	[[nodiscard]]
+	bool roi(cv::Rect& roi);
+
+	// binned pixels average the ones they cover, decimated ones keep the first
+	[[nodiscard]]
+	bool set_binning(size_t horizontal, size_t vertical);
+
+	[[nodiscard]]
+	bool set_decimation(size_t horizontal, size_t vertical);
+
+	// in binned and decimated pixels, clipped to the image, empty or outside meaning the whole sensor
+	[[nodiscard]]
+	bool set_roi(const cv::Rect& roi);
 };
 
 }
@@ -0,0 +1,170 @@
+#ifndef __UTILITIES_CAMERA_GROUP_HPP__
+#define __UTILITIES_CAMERA_GROUP_HPP__
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "utilities/camera/base.hpp"
+#include "utilities/camera/ring.hpp"
+
+namespace utilities::camera
+{
+
+// Pulls the frames of several devices triggered together and assembles them into sets of one frame per device.
+class group final
+{
+public:
+	// key frames are matched on, the tolerance of the group is expressed in its unit
+	enum class alignment
+	{
+		// local frame counters, for devices subscribed together that never drop a frame
+		FRAME_ID,
+		// SDK block ids, for devices started together
+		BLOCK_ID,
+		// device ticks, for devices with synchronised clocks
+		DEVICE_TIMESTAMP,
+		// host arrival times in nanoseconds
+		HOST_TIMESTAMP
+	};
+
+	enum class incomplete_policy
+	{
+		DROP,
+		// the missing frames are left empty
+		DELIVER
+	};
+
+	struct frame_set final
+	{
+		size_t id;
+		// one per device, in the order of the group
+		std::vector<base::frame> frames;
+
+		inline frame_set() noexcept : id(0), frames {} {}
+
+		[[nodiscard]]
+		inline bool complete() const noexcept
+		{
+			for (const auto& frame : frames)
+				if (!frame)
+					return false;
+			return !frames.empty();
+		}
+
+		[[nodiscard]]
+		inline operator bool() const noexcept { return id; }
+	};
+private:
+	struct pending final
+	{
+		uint64_t reference;
+		std::chrono::steady_clock::time_point opened;
+		std::vector<base::frame> frames;
+		size_t count;
+	};
+
+	std::vector<std::unique_ptr<base::device>> _devices;
+	alignment _alignment;
+	uint64_t _tolerance;
+	std::chrono::nanoseconds _timeout;
+	incomplete_policy _policy;
+
+	// guards the pending sets and the counter, and keeps the set queue to a single producer at a time;
+	// held by a puller blocked on a full queue, hence never taken on the consumer side
+	std::mutex _lock;
+	std::deque<pending> _pending;
+	ring<frame_set> _sets;
+	size_t _counter;
+	std::atomic<size_t> _incomplete;
+	std::atomic<size_t> _dropped;
+
+	std::mutex _error_lock;
+	std::error_code _error;
+
+	std::stop_source _stop;
+	std::vector<std::thread> _pullers;
+
+	void _join();
+
+	[[nodiscard]]
+	uint64_t _key(const base::frame& frame) const noexcept;
+
+	// must be called with the lock held
+	void _expire(std::chrono::steady_clock::time_point now);
+
+	// must be called with the lock held
+	void _match(size_t index, base::frame frame);
+
+	void _pull(size_t index, std::stop_token token);
+
+	// must be called with the lock held
+	void _resolve(pending& set);
+public:
+	group(
+		std::vector<std::unique_ptr<base::device>> devices,
+		alignment alignment,
+		uint64_t tolerance,
+		const std::chrono::nanoseconds& timeout,
+		incomplete_policy policy = incomplete_policy::DROP
+	);
+
+	group(const group&) = delete;
+
+	group(group&&) = delete;
+
+	~group() noexcept;
+
+	group& operator=(const group&) = delete;
+
+	group& operator=(group&&) = delete;
+
+	[[nodiscard]]
+	base::device& operator[](size_t index);
+
+	// incomplete sets dropped by the policy and sets dropped by the queue
+	[[nodiscard]]
+	size_t dropped_sets() const;
+
+	// sets left incomplete, delivered or not
+	[[nodiscard]]
+	size_t incomplete_sets() const;
+
+	// returns an empty set if none completes before the timeout or the stop request
+	[[nodiscard]]
+	frame_set next_set(std::error_code& ec, std::stop_token token, const std::chrono::nanoseconds& timeout);
+
+	[[nodiscard]]
+	frame_set next_set(std::stop_token token, const std::chrono::nanoseconds& timeout);
+
+	template<typename Rep, typename Period>
+	[[nodiscard]]
+	inline frame_set next_set(std::stop_token token, const std::chrono::duration<Rep, Period>& timeout)
+	{
+		return next_set(std::move(token), std::chrono::duration_cast<std::chrono::nanoseconds>(timeout));
+	}
+
+	// must not be called while started
+	void queue(size_t capacity, overflow_policy policy);
+
+	[[nodiscard]]
+	size_t size() const noexcept;
+
+	// subscribes and starts every device, then pulls their frames until stopped
+	void start();
+
+	void stop();
+};
+
+}
+
+#endif
@@ -2,11 +2,13 @@
 #define __UTILITIES_CAMERA_HIKVISION_HPP__
 
 #include <cstddef>
+#include <cstdint>
 
+#include <atomic>
 #include <chrono>
-#include <list>
 #include <memory>
-#include <mutex>
+#include <optional>
+#include <stop_token>
 #include <string>
 #include <vector>
 
@@ -14,6 +16,9 @@
 #include <opencv2/core.hpp>
 
 #include "utilities/camera/base.hpp"
+#include "utilities/camera/pool.hpp"
+#include "utilities/camera/pyramid.hpp"
+#include "utilities/camera/ring.hpp"
 
 namespace utilities::camera
 {
@@ -28,14 +33,30 @@ struct hikvision final : public base::device
 private:
 	static void _callback(unsigned char *data, ::MV_FRAME_OUT_INFO_EX *info, void *user);
 
+	static void _exception(unsigned int type, void *user);
+
 	void *_handle;
+	// kept to find the device again once lost
+	std::string _serial;
+	unsigned int _layer;
 	bool _colour;
+	bool _raw;
 	base::rotation_direction _rotation;
-	std::mutex _lock;
-	std::list<cv::Mat> _images;
+	cv::Mat _converted;
+	frame_pool _buffers;
+	ring<base::frame> _images;
 	size_t _counter;
+	std::optional<uint64_t> _last_block_id;
+	device_statistics _statistics;
+	thread_binder _binder;
+	pyramid_builder _pyramid;
+	bool _grabbing;
+	std::atomic<bool> _disconnected;
 
 	hikvision(const ::MV_CC_DEVICE_INFO *device_info, bool colour);
+
+	// sizes the pool for the current geometry and pixel format, which may have changed since the last start
+	void _reserve();
 public:
 	[[nodiscard]]
 	static std::vector<std::unique_ptr<hikvision>> find(
@@ -48,6 +69,14 @@ public:
 
 	// base::device
 
+	[[nodiscard]]
+	virtual const thread_affinity& acquisition_thread() const override;
+
+	virtual void acquisition_thread(thread_affinity affinity) override;
+
+	[[nodiscard]]
+	virtual parameter_report apply(const parameter_set& parameters) override;
+
 	[[nodiscard]]
 	inline virtual base::brand brand() const override
 	{
@@ -56,11 +85,47 @@ public:
 
 	virtual void close() override;
 
+	[[nodiscard]]
+	virtual bool disconnected() const override;
+
+	[[nodiscard]]
+	virtual size_t dropped_frames() const override;
+
+	virtual void listener(ring_listener *listener) override;
+
+	using base::device::next_image;
+
 	[[nodiscard]]
 	virtual base::frame next_image(std::error_code& ec) override;
 
+	[[nodiscard]]
+	virtual base::frame next_image(
+		std::error_code& ec,
+		std::stop_token token,
+		const std::chrono::nanoseconds& timeout
+	) override;
+
 	virtual void open() override;
 
+	[[nodiscard]]
+	virtual frame_pool& pool() override;
+
+	[[nodiscard]]
+	virtual size_t pyramid() const override;
+
+	virtual void pyramid(size_t levels) override;
+
+	virtual void queue(size_t capacity, overflow_policy policy) override;
+
+	[[nodiscard]]
+	virtual bool raw() const override;
+
+	virtual void raw(bool enable) override;
+
+	virtual void reconnect() override;
+
+	virtual void reset_statistics() override;
+
 	[[nodiscard]]
 	virtual base::rotation_direction rotation() const override;
 
@@ -71,6 +136,9 @@ public:
 
 	virtual void start() override;
 
+	[[nodiscard]]
+	virtual device_statistics::snapshot statistics() const override;
+
 	virtual void stop() override;
 
 	virtual void subscribe() override;
@@ -125,6 +193,22 @@ public:
 			std::chrono::duration_cast<std::chrono::duration<double, std::micro>>(delay)
 		);
 	}
+
+	// sensor window, not to be changed while started
+
+	[[nodiscard]]
+	bool roi(cv::Rect& roi);
+
+	// binning and decimation reset the window on most sensors, hence come first
+	[[nodiscard]]
+	bool set_binning(size_t horizontal, size_t vertical);
+
+	[[nodiscard]]
+	bool set_decimation(size_t horizontal, size_t vertical);
+
+	// in binned and decimated pixels, widened to the increments of the sensor, empty meaning the whole sensor
+	[[nodiscard]]
+	bool set_roi(const cv::Rect& roi);
 };
 
 }
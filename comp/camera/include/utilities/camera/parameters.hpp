@@ -0,0 +1,116 @@
+#ifndef __UTILITIES_CAMERA_PARAMETERS_HPP__
+#define __UTILITIES_CAMERA_PARAMETERS_HPP__
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <system_error>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace utilities::camera
+{
+
+// symbol of a GenICam enumeration node, as opposed to the value of a string node
+struct enumeration final
+{
+	std::string symbol;
+
+	inline bool operator==(const enumeration&) const = default;
+};
+
+using parameter_value = std::variant<bool, int64_t, double, enumeration, std::string>;
+
+struct parameter final
+{
+	std::string name;
+	parameter_value value;
+};
+
+// Node writes applied to a device in order, as a single transaction.
+// Commands are left out, as they cannot be rolled back.
+class parameter_set final
+{
+	std::vector<parameter> _parameters;
+
+	inline parameter_set& _add(std::string name, parameter_value value)
+	{
+		_parameters.push_back({ std::move(name), std::move(value) });
+		return *this;
+	}
+public:
+	[[nodiscard]]
+	inline auto begin() const noexcept
+	{
+		return _parameters.begin();
+	}
+
+	inline parameter_set& boolean(std::string name, bool value)
+	{
+		return _add(std::move(name), value);
+	}
+
+	[[nodiscard]]
+	inline bool empty() const noexcept
+	{
+		return _parameters.empty();
+	}
+
+	[[nodiscard]]
+	inline auto end() const noexcept
+	{
+		return _parameters.end();
+	}
+
+	inline parameter_set& enumerated(std::string name, std::string symbol)
+	{
+		return _add(std::move(name), enumeration { std::move(symbol) });
+	}
+
+	inline parameter_set& integer(std::string name, int64_t value)
+	{
+		return _add(std::move(name), value);
+	}
+
+	inline parameter_set& real(std::string name, double value)
+	{
+		return _add(std::move(name), value);
+	}
+
+	[[nodiscard]]
+	inline size_t size() const noexcept
+	{
+		return _parameters.size();
+	}
+
+	inline parameter_set& string(std::string name, std::string value)
+	{
+		return _add(std::move(name), std::move(value));
+	}
+};
+
+struct parameter_failure final
+{
+	// index in the set
+	size_t index;
+	std::string name;
+	std::error_code ec;
+};
+
+struct parameter_report final
+{
+	// every write is attempted, so that a single pass reports all the faulty ones
+	std::vector<parameter_failure> failures;
+	// writes that could not be undone, leaving the device inconsistent
+	std::vector<parameter_failure> rollback_failures;
+	bool rolled_back = false;
+
+	[[nodiscard]]
+	inline explicit operator bool() const noexcept { return failures.empty(); }
+};
+
+}
+
+#endif
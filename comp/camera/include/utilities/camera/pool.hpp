@@ -0,0 +1,61 @@
+#ifndef __UTILITIES_CAMERA_POOL_HPP__
+#define __UTILITIES_CAMERA_POOL_HPP__
+
+#include <cstddef>
+
+#include <opencv2/core.hpp>
+
+namespace utilities::camera
+{
+
+// Recycles the pixel storage of frames handed out by a device once every cv::Mat referencing it is released.
+// Frames may safely outlive the pool and the device owning it.
+class frame_pool final
+{
+	class allocator;
+
+	allocator *_allocator;
+public:
+	static constexpr size_t default_capacity = 24;
+
+	frame_pool(size_t capacity = default_capacity);
+
+	frame_pool(const frame_pool&) = delete;
+
+	frame_pool(frame_pool&&) = delete;
+
+	~frame_pool() noexcept;
+
+	frame_pool& operator=(const frame_pool&) = delete;
+
+	frame_pool& operator=(frame_pool&&) = delete;
+
+	// releases the current content of the image and reallocates it from the pool
+	void acquire(cv::Mat& image, int rows, int cols, int type);
+
+	// maximum number of idle buffers kept for reuse
+	[[nodiscard]]
+	size_t capacity() const noexcept;
+
+	void capacity(size_t capacity);
+
+	// maximum number of buffers simultaneously handed out since the last reset
+	[[nodiscard]]
+	size_t high_water_mark() const noexcept;
+
+	[[nodiscard]]
+	size_t in_use() const noexcept;
+
+	// pre-allocates idle buffers for frames of the given geometry, dropping those of any other size
+	void reserve(size_t count, int rows, int cols, int type);
+
+	void reset_high_water_mark() noexcept;
+
+	// number of buffers currently owned by the pool, idle or in use
+	[[nodiscard]]
+	size_t size() const noexcept;
+};
+
+}
+
+#endif
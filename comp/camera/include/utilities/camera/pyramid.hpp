@@ -0,0 +1,44 @@
+#ifndef __UTILITIES_CAMERA_PYRAMID_HPP__
+#define __UTILITIES_CAMERA_PYRAMID_HPP__
+
+#include <cstddef>
+
+#include <array>
+
+#include "utilities/camera/base.hpp"
+#include "utilities/camera/pool.hpp"
+
+namespace utilities::camera
+{
+
+// Builds the reduced levels of frames once, on the acquisition thread, in pooled buffers.
+// Each level averages the 2x2 blocks of the previous one, a trailing odd row or column being left out,
+// so that coordinates scale by exactly 2 per level.
+class pyramid_builder final
+{
+	std::array<frame_pool, base::frame::pyramid_levels - 1> _pools;
+	size_t _levels;
+public:
+	pyramid_builder();
+
+	pyramid_builder(const pyramid_builder&) = delete;
+
+	pyramid_builder(pyramid_builder&&) = delete;
+
+	pyramid_builder& operator=(const pyramid_builder&) = delete;
+
+	pyramid_builder& operator=(pyramid_builder&&) = delete;
+
+	// leaves raw frames and frames already reduced untouched
+	void build(base::frame& frame);
+
+	[[nodiscard]]
+	size_t levels() const noexcept;
+
+	// throws if out of range
+	void levels(size_t levels);
+};
+
+}
+
+#endif
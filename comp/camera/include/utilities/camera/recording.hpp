@@ -0,0 +1,190 @@
+#ifndef __UTILITIES_CAMERA_RECORDING_HPP__
+#define __UTILITIES_CAMERA_RECORDING_HPP__
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stop_token>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "utilities/camera/base.hpp"
+#include "utilities/camera/pool.hpp"
+#include "utilities/camera/ring.hpp"
+
+namespace utilities::camera
+{
+
+enum class recording_encoding
+{
+	// pixels as delivered, mapped back without any copy on replay
+	RAW,
+	// lossless, encoded by as many threads as needed to keep up
+	PNG
+};
+
+// Appends frames to a recording on a writer thread of its own, see replay to read it back.
+// Frames are queued by reference, hence must not be written to once recorded.
+// Frames arriving while the queue is full are dropped rather than waited for.
+class recorder final
+{
+	std::ofstream _file;
+	recording_encoding _encoding;
+	ring<base::frame> _frames;
+	// serialized entries, appended to the file on close
+	std::vector<char> _index;
+	uint64_t _offset;
+	std::atomic<size_t> _recorded;
+	std::atomic<int> _error;
+
+	std::stop_source _stop;
+	std::thread _writer;
+
+	void _append(std::vector<base::frame>& batch);
+
+	void _write(std::stop_token token);
+public:
+	static constexpr size_t default_capacity = 64;
+
+	// truncates any existing file
+	recorder(
+		const std::filesystem::path& path,
+		const std::string& serial,
+		base::brand brand,
+		recording_encoding encoding = recording_encoding::RAW,
+		size_t capacity = default_capacity
+	);
+
+	recorder(const recorder&) = delete;
+
+	recorder(recorder&&) = delete;
+
+	// writes the frames still queued, then the index
+	~recorder() noexcept;
+
+	recorder& operator=(const recorder&) = delete;
+
+	recorder& operator=(recorder&&) = delete;
+
+	[[nodiscard]]
+	size_t dropped() const noexcept;
+
+	// the first failure to write since the last call, the recording stopping there
+	[[nodiscard]]
+	std::error_code error() noexcept;
+
+	// from a single thread, never blocks
+	void record(const base::frame& frame);
+
+	[[nodiscard]]
+	size_t recorded() const noexcept;
+};
+
+// Records every frame handed out by a device, as it is handed out.
+// Recording failures are reported by next_image.
+class recording final : public base::device
+{
+	std::unique_ptr<base::device> _device;
+	recorder _recorder;
+public:
+	recording(
+		std::unique_ptr<base::device> device,
+		const std::filesystem::path& path,
+		recording_encoding encoding = recording_encoding::RAW,
+		size_t capacity = recorder::default_capacity
+	);
+
+	virtual ~recording() noexcept override = default;
+
+	[[nodiscard]]
+	base::device& inner() noexcept;
+
+	[[nodiscard]]
+	const recorder& sink() const noexcept;
+
+	// base::device
+
+	[[nodiscard]]
+	virtual const thread_affinity& acquisition_thread() const override;
+
+	virtual void acquisition_thread(thread_affinity affinity) override;
+
+	[[nodiscard]]
+	virtual parameter_report apply(const parameter_set& parameters) override;
+
+	[[nodiscard]]
+	virtual base::brand brand() const override;
+
+	virtual void close() override;
+
+	[[nodiscard]]
+	virtual bool disconnected() const override;
+
+	[[nodiscard]]
+	virtual size_t dropped_frames() const override;
+
+	virtual void listener(ring_listener *listener) override;
+
+	using base::device::next_image;
+
+	[[nodiscard]]
+	virtual base::frame next_image(std::error_code& ec) override;
+
+	[[nodiscard]]
+	virtual base::frame next_image(
+		std::error_code& ec,
+		std::stop_token token,
+		const std::chrono::nanoseconds& timeout
+	) override;
+
+	virtual void open() override;
+
+	[[nodiscard]]
+	virtual frame_pool& pool() override;
+
+	[[nodiscard]]
+	virtual size_t pyramid() const override;
+
+	virtual void pyramid(size_t levels) override;
+
+	virtual void queue(size_t capacity, overflow_policy policy) override;
+
+	[[nodiscard]]
+	virtual bool raw() const override;
+
+	virtual void raw(bool enable) override;
+
+	virtual void reconnect() override;
+
+	virtual void reset_statistics() override;
+
+	[[nodiscard]]
+	virtual base::rotation_direction rotation() const override;
+
+	virtual void rotation(base::rotation_direction direction) override;
+
+	[[nodiscard]]
+	virtual std::string serial() const override;
+
+	virtual void start() override;
+
+	[[nodiscard]]
+	virtual device_statistics::snapshot statistics() const override;
+
+	virtual void stop() override;
+
+	virtual void subscribe() override;
+
+	virtual void unsubscribe() override;
+};
+
+}
+
+#endif
@@ -0,0 +1,199 @@
+#ifndef __UTILITIES_CAMERA_REPLAY_HPP__
+#define __UTILITIES_CAMERA_REPLAY_HPP__
+
+#include <cstddef>
+#include <cstdint>
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "utilities/camera/base.hpp"
+#include "utilities/camera/pool.hpp"
+#include "utilities/camera/pyramid.hpp"
+#include "utilities/camera/ring.hpp"
+
+namespace utilities::camera
+{
+
+// Plays a recording back as a device, following the timing of the frames as they were received.
+// Raw frames share the read-only pages of the mapped recording.
+class replay final : public base::device
+{
+	struct record final
+	{
+		uint64_t id;
+		int64_t host_timestamp;
+		uint64_t offset;
+	};
+
+	// owns the mapping
+	std::shared_ptr<const void> _mapping;
+	const char *_data;
+	size_t _size;
+	std::vector<record> _records;
+	int64_t _steady_origin;
+	int64_t _system_origin;
+	base::brand _brand;
+	std::string _serial;
+	bool _raw;
+	base::rotation_direction _rotation;
+	size_t _index;
+	double _speed;
+	bool _looping;
+	frame_pool _buffers;
+	ring<base::frame> _images;
+	size_t _counter;
+	device_statistics _statistics;
+	thread_binder _binder;
+	pyramid_builder _pyramid;
+
+	std::stop_source _stop;
+	std::thread _simulation;
+
+	explicit replay(const std::filesystem::path& path);
+
+	void _emit(const record& record);
+
+	void _simulate(std::stop_token token);
+public:
+	// recordings are looked for as <serial>.rec under the base directory
+	[[nodiscard]]
+	static std::vector<std::unique_ptr<replay>> find(
+		const std::filesystem::path& base,
+		std::vector<std::string> serials
+	);
+
+	// the recording may have been cut short, its complete frames are then replayed
+	[[nodiscard]]
+	static std::unique_ptr<replay> load(const std::filesystem::path& path);
+
+	virtual ~replay() noexcept override;
+
+	// base::device
+
+	[[nodiscard]]
+	virtual const thread_affinity& acquisition_thread() const override;
+
+	virtual void acquisition_thread(thread_affinity affinity) override;
+
+	// a recording has no parameters to change, every write fails
+	[[nodiscard]]
+	virtual parameter_report apply(const parameter_set& parameters) override;
+
+	// of the recorded device
+	[[nodiscard]]
+	inline virtual base::brand brand() const override
+	{
+		return _brand;
+	}
+
+	inline virtual void close() override {}
+
+	// a recording is never lost
+	[[nodiscard]]
+	inline virtual bool disconnected() const override
+	{
+		return false;
+	}
+
+	[[nodiscard]]
+	virtual size_t dropped_frames() const override;
+
+	virtual void listener(ring_listener *listener) override;
+
+	using base::device::next_image;
+
+	[[nodiscard]]
+	virtual base::frame next_image(std::error_code& ec) override;
+
+	[[nodiscard]]
+	virtual base::frame next_image(
+		std::error_code& ec,
+		std::stop_token token,
+		const std::chrono::nanoseconds& timeout
+	) override;
+
+	inline virtual void open() override {}
+
+	[[nodiscard]]
+	virtual frame_pool& pool() override;
+
+	[[nodiscard]]
+	virtual size_t pyramid() const override;
+
+	virtual void pyramid(size_t levels) override;
+
+	virtual void queue(size_t capacity, overflow_policy policy) override;
+
+	// raw frames are delivered as recorded, developed into 8-bit BGR or mono images otherwise
+	[[nodiscard]]
+	virtual bool raw() const override;
+
+	virtual void raw(bool enable) override;
+
+	inline virtual void reconnect() override {}
+
+	virtual void reset_statistics() override;
+
+	// applied on top of the recorded frames, except raw ones
+	[[nodiscard]]
+	virtual base::rotation_direction rotation() const override;
+
+	virtual void rotation(base::rotation_direction direction) override;
+
+	[[nodiscard]]
+	virtual std::string serial() const override;
+
+	// resumes where the last stop left off
+	virtual void start() override;
+
+	[[nodiscard]]
+	virtual device_statistics::snapshot statistics() const override;
+
+	virtual void stop() override;
+
+	virtual void subscribe() override;
+
+	inline virtual void unsubscribe() override {}
+
+	// playback, not to be changed while started
+
+	[[nodiscard]]
+	size_t frames() const noexcept;
+
+	// restarts from the first frame once the last one is played, instead of stopping there
+	void looping(bool enable);
+
+	// index of the next frame to be played
+	[[nodiscard]]
+	size_t position() const noexcept;
+
+	// to the first frame of the given id, as handed out by the recorded device, returns false if there is none
+	[[nodiscard]]
+	bool seek(size_t id);
+
+	// to the first frame received at or after the given time, returns false if there is none
+	[[nodiscard]]
+	bool seek(const std::chrono::system_clock::time_point& time);
+
+	[[nodiscard]]
+	double speed() const noexcept;
+
+	// relative to the recorded timing, zero playing frames as fast as the queue accepts them
+	void speed(double speed);
+
+	// wall time at which the frame at the given index was received by the recorded device
+	[[nodiscard]]
+	std::chrono::system_clock::time_point received(size_t index) const;
+};
+
+}
+
+#endif
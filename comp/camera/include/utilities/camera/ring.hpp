@@ -0,0 +1,322 @@
+#ifndef __UTILITIES_CAMERA_RING_HPP__
+#define __UTILITIES_CAMERA_RING_HPP__
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <stop_token>
+#include <thread>
+#include <utility>
+
+namespace utilities::camera
+{
+
+enum class overflow_policy
+{
+	DROP_OLDEST,
+	DROP_NEWEST,
+	BLOCK
+};
+
+// Notified by the producer of a ring, from its own thread, after every push. Must neither block nor throw.
+class ring_listener
+{
+public:
+	virtual void pushed() noexcept = 0;
+protected:
+	inline ~ring_listener() noexcept = default;
+};
+
+// Bounded queue between the SDK grabbing thread (the only producer) and the consumer of a device.
+// The producer may also act as a second consumer when it discards the oldest element on overflow.
+template<typename T>
+class ring final
+{
+	static constexpr size_t _cache_line = 64;
+
+	// 2 * pos while free for the push at pos, 2 * pos + 1 once written, so that a single slot is never both
+	struct slot final
+	{
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	std::unique_ptr<slot[]> _slots;
+	size_t _capacity;
+	overflow_policy _policy;
+	alignas(_cache_line) std::atomic<size_t> _head;
+	alignas(_cache_line) std::atomic<size_t> _tail;
+	alignas(_cache_line) std::atomic<size_t> _dropped;
+	// futex-sized counter bumped on every release, waited on by a blocked producer
+	alignas(_cache_line) std::atomic<uint32_t> _released;
+	// turns the pushes that would block into drops
+	std::atomic<bool> _stopping;
+	// only touched by the producer when a consumer is sleeping
+	alignas(_cache_line) std::atomic<uint32_t> _waiters;
+	// bumped by wake, ending the sleep of a consumer whatever the queue holds
+	std::atomic<uint32_t> _wakeups;
+	std::mutex _waiting_lock;
+	std::condition_variable_any _available;
+	alignas(_cache_line) std::atomic<ring_listener *> _listener;
+	// producer calls in progress into the listener
+	std::atomic<uint32_t> _notifying;
+
+	inline void _notify() noexcept
+	{
+		_notifying.fetch_add(1, std::memory_order_seq_cst);
+		if (auto listener = _listener.load(std::memory_order_seq_cst))
+			listener->pushed();
+		_notifying.fetch_sub(1, std::memory_order_release);
+	}
+
+	[[nodiscard]]
+	inline bool _pop(T& value)
+	{
+		auto pos = _tail.load(std::memory_order_relaxed);
+		slot *current;
+		while (true)
+		{
+			current = &_slots[pos % _capacity];
+			auto diff = intptr_t(current->sequence.load(std::memory_order_acquire)) - intptr_t(2 * pos + 1);
+			if (diff == 0)
+			{
+				if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0)
+				return false;
+			else
+				pos = _tail.load(std::memory_order_relaxed);
+		}
+
+		value = std::move(current->value);
+		current->sequence.store(2 * (pos + _capacity), std::memory_order_release);
+		if (_policy == overflow_policy::BLOCK)
+		{
+			_released.fetch_add(1, std::memory_order_release);
+			_released.notify_one();
+		}
+		return true;
+	}
+public:
+	static constexpr size_t default_capacity = 16;
+
+	inline ring(size_t capacity = default_capacity, overflow_policy policy = overflow_policy::DROP_OLDEST) :
+		_slots {},
+		_capacity(0),
+		_policy(policy),
+		_head(0),
+		_tail(0),
+		_dropped(0),
+		_released(0),
+		_stopping(false),
+		_waiters(0),
+		_wakeups(0),
+		_waiting_lock {},
+		_available {},
+		_listener(nullptr),
+		_notifying(0)
+	{
+		reset(capacity, policy);
+	}
+
+	ring(const ring&) = delete;
+
+	ring(ring&&) = delete;
+
+	inline ~ring() noexcept = default;
+
+	ring& operator=(const ring&) = delete;
+
+	ring& operator=(ring&&) = delete;
+
+	[[nodiscard]]
+	inline size_t capacity() const noexcept
+	{
+		return _capacity;
+	}
+
+	// consumer side only
+	inline void clear()
+	{
+		T discarded;
+		while (_pop(discarded))
+			discarded = T {};
+	}
+
+	[[nodiscard]]
+	inline size_t dropped() const noexcept
+	{
+		return _dropped.load(std::memory_order_relaxed);
+	}
+
+	// replaces the listener, and once it returns the previous one is no longer called, hence not from within it
+	inline void listener(ring_listener *listener) noexcept
+	{
+		_listener.store(listener, std::memory_order_seq_cst);
+		while (_notifying.load(std::memory_order_seq_cst))
+			std::this_thread::yield();
+	}
+
+	[[nodiscard]]
+	inline overflow_policy policy() const noexcept
+	{
+		return _policy;
+	}
+
+	// consumer side only
+	[[nodiscard]]
+	inline bool pop(T& value)
+	{
+		return _pop(value);
+	}
+
+	// consumer side only, sleeps until a value arrives, the timeout expires, a stop is requested or the ring is woken
+	template<typename Rep, typename Period>
+	[[nodiscard]]
+	inline bool pop(T& value, std::stop_token token, const std::chrono::duration<Rep, Period>& timeout)
+	{
+		const auto wakeups = _wakeups.load(std::memory_order_seq_cst);
+		if (_pop(value))
+			return true;
+
+		auto guard = std::unique_lock { _waiting_lock };
+		_waiters.fetch_add(1, std::memory_order_seq_cst);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		bool ret = false;
+		_available.wait_for(guard, token, timeout, [this, &value, &ret, wakeups]
+		{
+			return (ret = _pop(value)) || _wakeups.load(std::memory_order_seq_cst) != wakeups;
+		});
+		_waiters.fetch_sub(1, std::memory_order_relaxed);
+		return ret;
+	}
+
+	template<typename Rep, typename Period>
+	[[nodiscard]]
+	inline bool pop(T& value, const std::chrono::duration<Rep, Period>& timeout)
+	{
+		return pop(value, {}, timeout);
+	}
+
+	// producer side only, returns false if the value has been dropped
+	inline bool push(T&& value)
+	{
+		auto pos = _head.load(std::memory_order_relaxed);
+		auto& current = _slots[pos % _capacity];
+		while (true)
+		{
+			auto released = _released.load(std::memory_order_acquire);
+			if (current.sequence.load(std::memory_order_acquire) == 2 * pos)
+				break;
+
+			// the slot is still occupied by the element at (pos - capacity)
+			if (_tail.load(std::memory_order_acquire) > pos - _capacity)
+			{
+				// which has been claimed by the consumer but not yet moved out
+				std::this_thread::yield();
+				continue;
+			}
+
+			switch (_policy)
+			{
+				case overflow_policy::DROP_OLDEST:
+				{
+					T discarded;
+					if (_pop(discarded))
+						_dropped.fetch_add(1, std::memory_order_relaxed);
+					break;
+				}
+				case overflow_policy::DROP_NEWEST:
+					_dropped.fetch_add(1, std::memory_order_relaxed);
+					return false;
+				case overflow_policy::BLOCK:
+					if (_stopping.load(std::memory_order_acquire))
+					{
+						_dropped.fetch_add(1, std::memory_order_relaxed);
+						return false;
+					}
+					_released.wait(released, std::memory_order_acquire);
+					break;
+			}
+		}
+
+		current.value = std::move(value);
+		current.sequence.store(2 * pos + 1, std::memory_order_release);
+		_head.store(pos + 1, std::memory_order_relaxed);
+
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (_waiters.load(std::memory_order_relaxed))
+		{
+			// the sleeping consumer either has not checked the queue yet or is already waiting
+			{
+				auto guard = std::lock_guard { _waiting_lock };
+			}
+			_available.notify_one();
+		}
+
+		_notify();
+		return true;
+	}
+
+	// neither side may be active
+	inline void reset(size_t capacity, overflow_policy policy)
+	{
+		if (!capacity)
+			throw std::invalid_argument("ring capacity must be positive");
+
+		_slots = std::make_unique<slot[]>(capacity);
+		for (size_t i = 0; i < capacity; ++i)
+			_slots[i].sequence.store(2 * i, std::memory_order_relaxed);
+		_capacity = capacity;
+		_policy = policy;
+		_head.store(0, std::memory_order_relaxed);
+		_tail.store(0, std::memory_order_relaxed);
+		_dropped.store(0, std::memory_order_relaxed);
+		_released.store(0, std::memory_order_relaxed);
+	}
+
+	// Set around the stop of an SDK grab, which waits for a callback that would otherwise block on a full queue.
+	// A producer already blocked is woken up, and drops its value.
+	inline void stopping(bool stopping) noexcept
+	{
+		_stopping.store(stopping, std::memory_order_relaxed);
+		if (stopping)
+		{
+			_released.fetch_add(1, std::memory_order_release);
+			_released.notify_all();
+		}
+	}
+
+	[[nodiscard]]
+	inline size_t size() const noexcept
+	{
+		auto head = _head.load(std::memory_order_acquire), tail = _tail.load(std::memory_order_acquire);
+		return head > tail ? head - tail : 0;
+	}
+
+	// producer side only, ends the sleep of the consumer and notifies the listener as a push would, without a value,
+	// so that a state change made beforehand (e.g. an error to report) is looked at
+	inline void wake()
+	{
+		_wakeups.fetch_add(1, std::memory_order_seq_cst);
+		if (_waiters.load(std::memory_order_seq_cst))
+		{
+			{
+				auto guard = std::lock_guard { _waiting_lock };
+			}
+			_available.notify_one();
+		}
+		_notify();
+	}
+};
+
+}
+
+#endif
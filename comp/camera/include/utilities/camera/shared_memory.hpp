@@ -0,0 +1,215 @@
+#ifndef __UTILITIES_CAMERA_SHARED_MEMORY_HPP__
+#define __UTILITIES_CAMERA_SHARED_MEMORY_HPP__
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stop_token>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "utilities/camera/base.hpp"
+#include "utilities/camera/pool.hpp"
+#include "utilities/camera/pyramid.hpp"
+#include "utilities/camera/ring.hpp"
+
+namespace utilities::camera
+{
+
+namespace _shared_memory
+{
+
+class segment;
+
+}
+
+// Publishes the frames of a device to other processes through a shared memory segment named after its serial.
+// Frames are copied into the first slot no consumer holds, and dropped if there is none, so publishing never waits.
+// e.g. publishing the frames of fake, and reading them back in another process with shared_memory::find.
+class shared_memory_publisher final
+{
+	std::shared_ptr<_shared_memory::segment> _segment;
+	size_t _cursor;
+	uint64_t _published;
+	size_t _dropped;
+public:
+	static constexpr size_t default_slots = 32;
+
+	// replaces any segment left over by a previous publisher of the same serial
+	shared_memory_publisher(
+		const std::string& serial,
+		base::brand brand,
+		size_t frame_size,
+		size_t slots = default_slots
+	);
+
+	shared_memory_publisher(const shared_memory_publisher&) = delete;
+
+	shared_memory_publisher(shared_memory_publisher&&) = delete;
+
+	// consumers are told, woken if waiting, and keep the frames they hold
+	~shared_memory_publisher() noexcept;
+
+	shared_memory_publisher& operator=(const shared_memory_publisher&) = delete;
+
+	shared_memory_publisher& operator=(shared_memory_publisher&&) = delete;
+
+	// frames larger than the slots or not finding any free slot, the slots of crashed consumers being freed first
+	[[nodiscard]]
+	size_t dropped() const noexcept;
+
+	// returns false if the frame has been dropped
+	bool publish(const base::frame& frame);
+
+	[[nodiscard]]
+	uint64_t published() const noexcept;
+};
+
+// Reads the frames of a shared_memory_publisher of another process, the pixels staying in the shared slots.
+// A slot is held until the last cv::Mat referencing it is released, or the process exits, frames must be treated as read-only.
+// Up to 64 devices, in any number of processes, read a segment at once.
+class shared_memory final : public base::device
+{
+	std::shared_ptr<_shared_memory::segment> _segment;
+	std::string _serial;
+	base::brand _brand;
+	bool _raw;
+	base::rotation_direction _rotation;
+	uint64_t _last;
+	std::chrono::nanoseconds _poll_interval;
+	frame_pool _buffers;
+	ring<base::frame> _images;
+	size_t _counter;
+	device_statistics _statistics;
+	thread_binder _binder;
+	pyramid_builder _pyramid;
+	std::atomic<int> _error;
+	// frame numbers and slots found complete by a poll
+	std::vector<std::pair<uint64_t, size_t>> _candidates;
+
+	std::stop_source _stop;
+	std::thread _receiver;
+
+	explicit shared_memory(std::shared_ptr<_shared_memory::segment> segment);
+
+	// once the queue is found empty, reports the publisher gone a single time,
+	// returns true instead if a frame published right before the close arrived meanwhile
+	[[nodiscard]]
+	bool _closed(base::frame& frame, std::error_code& ec);
+
+	// returns the number of frames taken from the segment
+	size_t _poll();
+
+	void _receive(std::stop_token token);
+public:
+	// attaches to the segments of the serials whose publisher is running and has a reader entry left
+	[[nodiscard]]
+	static std::vector<std::unique_ptr<shared_memory>> find(std::vector<std::string> serials);
+
+	virtual ~shared_memory() noexcept override;
+
+	// base::device
+
+	[[nodiscard]]
+	virtual const thread_affinity& acquisition_thread() const override;
+
+	virtual void acquisition_thread(thread_affinity affinity) override;
+
+	// the parameters belong to the publishing process, every write fails
+	[[nodiscard]]
+	virtual parameter_report apply(const parameter_set& parameters) override;
+
+	// of the publishing device
+	[[nodiscard]]
+	inline virtual base::brand brand() const override
+	{
+		return _brand;
+	}
+
+	// stops receiving, a consumer waiting for a frame being woken with none
+	virtual void close() override;
+
+	// once the publisher is gone, a crashed one being noticed by the frame timeout of a supervisor only
+	[[nodiscard]]
+	virtual bool disconnected() const override;
+
+	[[nodiscard]]
+	virtual size_t dropped_frames() const override;
+
+	virtual void listener(ring_listener *listener) override;
+
+	using base::device::next_image;
+
+	// fails with connection_reset, a single time, once the publisher is gone and every frame it published is delivered
+	[[nodiscard]]
+	virtual base::frame next_image(std::error_code& ec) override;
+
+	[[nodiscard]]
+	virtual base::frame next_image(
+		std::error_code& ec,
+		std::stop_token token,
+		const std::chrono::nanoseconds& timeout
+	) override;
+
+	inline virtual void open() override {}
+
+	[[nodiscard]]
+	virtual frame_pool& pool() override;
+
+	[[nodiscard]]
+	virtual size_t pyramid() const override;
+
+	virtual void pyramid(size_t levels) override;
+
+	virtual void queue(size_t capacity, overflow_policy policy) override;
+
+	// raw frames are delivered as published, developed into 8-bit BGR or mono images otherwise
+	[[nodiscard]]
+	virtual bool raw() const override;
+
+	virtual void raw(bool enable) override;
+
+	// attaches to the segment of the publisher currently running for the serial
+	virtual void reconnect() override;
+
+	virtual void reset_statistics() override;
+
+	// applied on top of the published frames, except raw ones
+	[[nodiscard]]
+	virtual base::rotation_direction rotation() const override;
+
+	virtual void rotation(base::rotation_direction direction) override;
+
+	[[nodiscard]]
+	virtual std::string serial() const override;
+
+	virtual void start() override;
+
+	[[nodiscard]]
+	virtual device_statistics::snapshot statistics() const override;
+
+	virtual void stop() override;
+
+	// only the frames published from then on are delivered
+	virtual void subscribe() override;
+
+	inline virtual void unsubscribe() override {}
+
+	// polling
+
+	[[nodiscard]]
+	std::chrono::nanoseconds poll_interval() const;
+
+	// the segment is polled, rather than waited on, so that any number of processes may read it
+	void poll_interval(const std::chrono::nanoseconds& interval);
+};
+
+}
+
+#endif
@@ -0,0 +1,142 @@
+#ifndef __UTILITIES_CAMERA_STATISTICS_HPP__
+#define __UTILITIES_CAMERA_STATISTICS_HPP__
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <string>
+
+namespace utilities::camera
+{
+
+// Counters of a device pipeline, written without locks by the SDK callback (producer side) and next_image (consumer side).
+class device_statistics final
+{
+public:
+	// bucket 0 counts latencies under 1 us, bucket i those in [2^(i-1), 2^i) us, the last one everything above
+	static constexpr size_t histogram_buckets = 24;
+
+	struct snapshot final
+	{
+		std::chrono::steady_clock::duration elapsed;
+		size_t received;
+		size_t delivered;
+		// by the queue of the device
+		size_t dropped;
+		// by the camera or the transport
+		size_t lost;
+		size_t queued;
+		std::chrono::nanoseconds callback_total;
+		std::chrono::nanoseconds callback_max;
+		std::chrono::nanoseconds conversion_total;
+		std::chrono::nanoseconds conversion_max;
+		// since the last frame received, or since the reset if none
+		std::chrono::nanoseconds idle;
+		// from the SDK callback to next_image
+		std::array<size_t, histogram_buckets> latency;
+
+		// frames received per second
+		[[nodiscard]]
+		double frame_rate() const noexcept;
+
+		// upper bound of the latency bucket holding the given quantile
+		[[nodiscard]]
+		std::chrono::microseconds latency_quantile(double quantile) const noexcept;
+
+		[[nodiscard]]
+		std::string json() const;
+
+		[[nodiscard]]
+		std::string text() const;
+	};
+private:
+	static constexpr size_t _cache_line = 64;
+
+	std::atomic<int64_t> _since;
+	// dropped count of the queue at the reset, the queue keeping its own since it was sized
+	std::atomic<size_t> _dropped_base;
+
+	// producer side
+	alignas(_cache_line) std::atomic<size_t> _received;
+	std::atomic<size_t> _lost;
+	std::atomic<int64_t> _callback_total;
+	std::atomic<int64_t> _callback_max;
+	std::atomic<int64_t> _conversion_total;
+	std::atomic<int64_t> _conversion_max;
+	std::atomic<int64_t> _last_received;
+
+	// consumer side
+	alignas(_cache_line) std::atomic<size_t> _delivered;
+	std::array<std::atomic<size_t>, histogram_buckets> _latency;
+
+	[[nodiscard]]
+	static inline int64_t _now() noexcept
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()
+		).count();
+	}
+
+	static inline void _raise(std::atomic<int64_t>& maximum, int64_t value) noexcept
+	{
+		auto current = maximum.load(std::memory_order_relaxed);
+		while (current < value && !maximum.compare_exchange_weak(current, value, std::memory_order_relaxed));
+	}
+public:
+	device_statistics() noexcept;
+
+	device_statistics(const device_statistics&) = delete;
+
+	device_statistics(device_statistics&&) = delete;
+
+	device_statistics& operator=(const device_statistics&) = delete;
+
+	device_statistics& operator=(device_statistics&&) = delete;
+
+	// called once per frame by the producer, the conversion being part of the callback
+	inline void record_callback(
+		std::chrono::steady_clock::time_point received,
+		std::chrono::steady_clock::time_point converted,
+		size_t gap
+	) noexcept
+	{
+		const auto now = _now();
+		const auto start = std::chrono::duration_cast<std::chrono::nanoseconds>(received.time_since_epoch()).count();
+		const auto conversion = std::chrono::duration_cast<std::chrono::nanoseconds>(converted - received).count();
+		_received.fetch_add(1, std::memory_order_relaxed);
+		_lost.fetch_add(gap, std::memory_order_relaxed);
+		_callback_total.fetch_add(now - start, std::memory_order_relaxed);
+		_raise(_callback_max, now - start);
+		_conversion_total.fetch_add(conversion, std::memory_order_relaxed);
+		_raise(_conversion_max, conversion);
+		_last_received.store(start, std::memory_order_relaxed);
+	}
+
+	// called once per frame by the consumer
+	inline void record_delivery(std::chrono::steady_clock::time_point received) noexcept
+	{
+		const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - received
+		).count();
+		const auto bucket = std::min<size_t>(std::bit_width(uint64_t(latency)), histogram_buckets - 1);
+		_delivered.fetch_add(1, std::memory_order_relaxed);
+		_latency[bucket].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// counters are reset one by one, so a snapshot taken concurrently may mix both periods,
+	// the dropped count of the queue being rebased on the one passed
+	void reset(size_t dropped) noexcept;
+
+	// the queue counters belong to the device, which passes them along, the dropped one as counted by the queue
+	[[nodiscard]]
+	snapshot take(size_t queued, size_t dropped) const noexcept;
+};
+
+}
+
+#endif
@@ -0,0 +1,191 @@
+#ifndef __UTILITIES_CAMERA_SUPERVISOR_HPP__
+#define __UTILITIES_CAMERA_SUPERVISOR_HPP__
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "utilities/camera/base.hpp"
+#include "utilities/camera/parameters.hpp"
+#include "utilities/camera/pool.hpp"
+#include "utilities/camera/ring.hpp"
+
+namespace utilities::camera
+{
+
+enum class connection_state
+{
+	CONNECTED,
+	// reported by the SDK, or no frame received within the frame timeout while started
+	LOST,
+	// before each attempt
+	RECONNECTING
+};
+
+// called from the watchdog thread with the cause of the loss, the failure of the last attempt,
+// or once connected again the first parameter set that could not be restored; must not call into the supervisor
+using connection_handler = std::function<void(connection_state state, const std::error_code& ec)>;
+
+// Reconnects a device lost while in use, until it is back, then restores what had been done through the supervisor:
+// the parameter sets successfully applied, in order, the subscription and the acquisition.
+// Frame ids keep increasing across reconnections, while the frames queued at the time of the loss are dropped.
+class supervisor final : public base::device
+{
+	std::unique_ptr<base::device> _device;
+	connection_handler _handler;
+	std::chrono::nanoseconds _frame_timeout;
+	std::chrono::nanoseconds _retry_interval;
+	// a set writing the same nodes as an earlier one supersedes it
+	std::vector<parameter_set> _applied;
+	bool _opened;
+	bool _subscribed;
+	bool _started;
+	std::chrono::steady_clock::time_point _started_at;
+	std::atomic<connection_state> _state;
+	std::atomic<size_t> _counter;
+	std::atomic<size_t> _reconnections;
+	// serialises the control calls with the watchdog
+	mutable std::mutex _lock;
+
+	std::stop_source _stop;
+	std::thread _watchdog;
+
+	void _notify(connection_state state, const std::error_code& ec);
+
+	void _recover(const std::stop_token& token, std::unique_lock<std::mutex>& lock, const std::error_code& cause);
+
+	// stops and unsubscribes the device, ignoring the failures of a device that is gone
+	void _release() noexcept;
+
+	// returns the first write that failed, the later sets being applied nonetheless
+	[[nodiscard]]
+	std::error_code _restore();
+
+	void _watch(std::stop_token token);
+public:
+	static constexpr std::chrono::milliseconds check_interval { 100 };
+
+	// a zero frame timeout relies on the SDK alone, as suits triggered devices
+	supervisor(
+		std::unique_ptr<base::device> device,
+		connection_handler handler = {},
+		const std::chrono::nanoseconds& frame_timeout = std::chrono::nanoseconds::zero(),
+		const std::chrono::nanoseconds& retry_interval = std::chrono::seconds(1)
+	);
+
+	virtual ~supervisor() noexcept override;
+
+	[[nodiscard]]
+	base::device& inner() noexcept;
+
+	[[nodiscard]]
+	size_t reconnections() const noexcept;
+
+	[[nodiscard]]
+	connection_state state() const noexcept;
+
+	// base::device
+
+	[[nodiscard]]
+	virtual const thread_affinity& acquisition_thread() const override;
+
+	virtual void acquisition_thread(thread_affinity affinity) override;
+
+	// successful sets are applied again after each reconnection
+	[[nodiscard]]
+	virtual parameter_report apply(const parameter_set& parameters) override;
+
+	[[nodiscard]]
+	virtual base::brand brand() const override;
+
+	virtual void close() override;
+
+	// from the loss being noticed until the device is back
+	[[nodiscard]]
+	virtual bool disconnected() const override;
+
+	[[nodiscard]]
+	virtual size_t dropped_frames() const override;
+
+	virtual void listener(ring_listener *listener) override;
+
+	using base::device::next_image;
+
+	// the failures of a lost device are held back while it is being reconnected
+	[[nodiscard]]
+	virtual base::frame next_image(std::error_code& ec) override;
+
+	[[nodiscard]]
+	virtual base::frame next_image(
+		std::error_code& ec,
+		std::stop_token token,
+		const std::chrono::nanoseconds& timeout
+	) override;
+
+	virtual void open() override;
+
+	[[nodiscard]]
+	virtual frame_pool& pool() override;
+
+	[[nodiscard]]
+	virtual size_t pyramid() const override;
+
+	virtual void pyramid(size_t levels) override;
+
+	virtual void queue(size_t capacity, overflow_policy policy) override;
+
+	[[nodiscard]]
+	virtual bool raw() const override;
+
+	virtual void raw(bool enable) override;
+
+	// restores the device as after an automatic reconnection, throwing if a parameter set could not be restored
+	virtual void reconnect() override;
+
+	virtual void reset_statistics() override;
+
+	[[nodiscard]]
+	virtual base::rotation_direction rotation() const override;
+
+	virtual void rotation(base::rotation_direction direction) override;
+
+	[[nodiscard]]
+	virtual std::string serial() const override;
+
+	virtual void start() override;
+
+	[[nodiscard]]
+	virtual device_statistics::snapshot statistics() const override;
+
+	virtual void stop() override;
+
+	virtual void subscribe() override;
+
+	virtual void unsubscribe() override;
+
+	// supervision
+
+	[[nodiscard]]
+	std::chrono::nanoseconds frame_timeout() const;
+
+	void frame_timeout(const std::chrono::nanoseconds& timeout);
+
+	[[nodiscard]]
+	std::chrono::nanoseconds retry_interval() const;
+
+	void retry_interval(const std::chrono::nanoseconds& interval);
+};
+
+}
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef __UTILITIES_CAMERA_THREAD_HPP__
+#define __UTILITIES_CAMERA_THREAD_HPP__
+
+#include <cstddef>
+
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace utilities::camera
+{
+
+struct thread_affinity final
+{
+	// logical CPUs the thread may run on, any if empty, only the first processor group on Windows
+	std::vector<size_t> cpus;
+	// native value, a SCHED_FIFO priority on POSIX and a THREAD_PRIORITY_* level on Windows, left untouched if absent
+	std::optional<int> priority;
+
+	[[nodiscard]]
+	inline bool empty() const noexcept
+	{
+		return cpus.empty() && !priority;
+	}
+};
+
+// applies the affinity to the calling thread
+void bind_current_thread(std::error_code& ec, const thread_affinity& affinity);
+
+void bind_current_thread(const thread_affinity& affinity);
+
+// Binds the threads an SDK delivers frames on, which are not ours to configure before they run.
+// Every callback calls bind(), which only does work on the first frame of a thread.
+class thread_binder final
+{
+	thread_affinity _affinity;
+	// written by the delivering thread, reset from the control one
+	std::atomic<std::thread::id> _bound;
+	// spares error() the lock while nothing failed
+	std::atomic<bool> _failed;
+	std::mutex _error_lock;
+	std::error_code _error;
+public:
+	thread_binder() noexcept;
+
+	thread_binder(const thread_binder&) = delete;
+
+	thread_binder(thread_binder&&) = delete;
+
+	thread_binder& operator=(const thread_binder&) = delete;
+
+	thread_binder& operator=(thread_binder&&) = delete;
+
+	[[nodiscard]]
+	const thread_affinity& affinity() const noexcept;
+
+	// must not be called while frames are delivered, threads already bound are not unbound
+	void affinity(thread_affinity affinity);
+
+	// called from the delivering thread
+	void bind() noexcept;
+
+	// returns then clears the last failure to bind
+	[[nodiscard]]
+	std::error_code error() noexcept;
+};
+
+}
+
+#endif
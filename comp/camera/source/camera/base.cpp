@@ -0,0 +1,123 @@
+#include <cstddef>
+
+#include <atomic>
+#include <coroutine>
+#include <system_error>
+#include <utility>
+
+#include "utilities/camera/base.hpp"
+#include "utilities/camera/event_loop.hpp"
+
+namespace utilities::camera::base
+{
+
+void frame_awaiter::pushed() noexcept
+{
+	if (!_pending.fetch_add(1, std::memory_order_acq_rel))
+		_loop.post(this);
+}
+
+void frame_awaiter::run() noexcept
+{
+	auto seen = _pending.load(std::memory_order_acquire);
+	while (true)
+	{
+		_frame = _device.next_image(_ec);
+		if (_frame || _ec)
+		{
+			// the notifications left pending keep the producer from posting the awaiter again
+			_device.listener(nullptr);
+			// the awaiter lives in the coroutine frame, hence is not touched anymore
+			std::exchange(_handle, nullptr).resume();
+			return;
+		}
+		// frames pushed in the meantime are looked for again, later ones post the awaiter anew
+		seen = _pending.fetch_sub(seen, std::memory_order_acq_rel) - seen;
+		if (!seen)
+			return;
+	}
+}
+
+frame_awaiter::frame_awaiter(device& device, event_loop& loop) noexcept :
+	_device(device),
+	_loop(loop),
+	_handle {},
+	_frame {},
+	_ec {},
+	_pending(0)
+{}
+
+frame_awaiter::~frame_awaiter() noexcept
+{
+	// a coroutine destroyed while suspended, whose awaiter may still be notified or queued
+	if (!_handle)
+		return;
+	_device.listener(nullptr);
+	_loop.cancel(this);
+}
+
+[[nodiscard]]
+bool frame_awaiter::await_ready()
+{
+	_frame = _device.next_image(_ec);
+	return _frame || _ec;
+}
+
+void frame_awaiter::await_suspend(std::coroutine_handle<> handle)
+{
+	_handle = handle;
+	// a frame may have been queued since await_ready, so the loop looks once whatever happens
+	_pending.store(1, std::memory_order_relaxed);
+	_device.listener(this);
+	_loop.post(this);
+}
+
+[[nodiscard]]
+frame frame_awaiter::await_resume()
+{
+	if (_ec)
+		throw std::system_error(_ec);
+	return std::move(_frame);
+}
+
+void frame_subscription::pushed() noexcept
+{
+	if (!_pending.fetch_add(1, std::memory_order_acq_rel))
+		_loop.post(this);
+}
+
+void frame_subscription::run() noexcept
+{
+	auto seen = _pending.load(std::memory_order_acquire);
+	do
+	{
+		while (true)
+		{
+			std::error_code ec;
+			auto frame = _device.next_image(ec);
+			if (!frame && !ec)
+				break;
+			_handler(ec, std::move(frame));
+		}
+	}
+	while ((seen = _pending.fetch_sub(seen, std::memory_order_acq_rel) - seen));
+}
+
+frame_subscription::frame_subscription(device& device, event_loop& loop, frame_handler handler) :
+	_device(device),
+	_loop(loop),
+	_handler { std::move(handler) },
+	_pending(1)
+{
+	// frames queued before the subscription are delivered too
+	_device.listener(this);
+	_loop.post(this);
+}
+
+frame_subscription::~frame_subscription() noexcept
+{
+	_device.listener(nullptr);
+	_loop.cancel(this);
+}
+
+}
@@ -3,12 +3,17 @@
 
 #include <algorithm>
 #include <array>
+#include <chrono>
 #include <memory>
-#include <mutex>
+#include <optional>
 #include <stdexcept>
+#include <stop_token>
 #include <string>
 #include <string_view>
 #include <system_error>
+#include <type_traits>
+#include <utility>
+#include <variant>
 #include <vector>
 
 #include <opencv2/core.hpp>
@@ -30,26 +35,150 @@ basler::image_listener::image_listener(bool colour) :
 	CBaslerUniversalImageEventHandler {},
 	_converter {},
 	_colour(colour),
+	_raw(false),
 	_rotation(base::rotation_direction::ORIGINAL),
-	_lock {},
+	_converted {},
+	_buffers {},
 	_images {},
-	_counter(0)
+	_counter(0),
+	_last_block_id {},
+	_statistics {},
+	_binder {},
+	_pyramid {},
+	_zero_copy(false)
 {
 	_converter.Initialize(_colour ? Pylon::PixelType_BGR8packed : Pylon::PixelType_Mono8);
 }
 
+[[nodiscard]]
+thread_binder& basler::image_listener::binder()
+{
+	return _binder;
+}
+
+[[nodiscard]]
+const thread_binder& basler::image_listener::binder() const
+{
+	return _binder;
+}
+
+[[nodiscard]]
+frame_pool& basler::image_listener::buffers()
+{
+	return _buffers;
+}
+
+[[nodiscard]]
+pyramid_builder& basler::image_listener::builder()
+{
+	return _pyramid;
+}
+
+[[nodiscard]]
+const pyramid_builder& basler::image_listener::builder() const
+{
+	return _pyramid;
+}
+
+[[nodiscard]]
+size_t basler::image_listener::capacity() const
+{
+	return _images.capacity();
+}
+
+[[nodiscard]]
+size_t basler::image_listener::dropped() const
+{
+	return _images.dropped();
+}
+
+void basler::image_listener::listener(ring_listener *listener)
+{
+	_images.listener(listener);
+}
+
 [[nodiscard]]
 base::frame basler::image_listener::next(std::error_code& ec)
 {
-	auto guard = std::lock_guard { _lock };
-	if (_images.empty())
+	ec = _binder.error();
+	if (ec)
+		return {};
+
+	base::frame ret;
+	if (!_images.pop(ret))
+		return {};
+
+	ret.id = ++_counter;
+	_statistics.record_delivery(ret.host_timestamp);
+	return ret;
+}
+
+[[nodiscard]]
+base::frame basler::image_listener::next(
+	std::error_code& ec,
+	std::stop_token token,
+	const std::chrono::nanoseconds& timeout
+)
+{
+	ec = _binder.error();
+	if (ec)
+		return {};
+
+	base::frame ret;
+	if (!_images.pop(ret, std::move(token), timeout))
 		return {};
 
-	base::frame ret { ++_counter, std::move(_images.front()) };
-	_images.pop_front();
+	ret.id = ++_counter;
+	_statistics.record_delivery(ret.host_timestamp);
 	return ret;
 }
 
+void basler::image_listener::queue(size_t capacity, overflow_policy policy)
+{
+	_images.reset(capacity, policy);
+}
+
+[[nodiscard]]
+bool basler::image_listener::raw() const
+{
+	return _raw;
+}
+
+void basler::image_listener::raw(bool enable)
+{
+	_raw = enable;
+}
+
+void basler::image_listener::reserve(Pylon::CBaslerUniversalInstantCamera& camera)
+{
+	if (!camera.Width.IsReadable() || !camera.Height.IsReadable())
+		return;
+	// the entries of the pixel format node are valued with their PFNC codes
+	if (_raw)
+	{
+		if (camera.PixelFormat.IsReadable())
+			_utils::reserve_raw(
+				_buffers,
+				_images.capacity(),
+				int(camera.Height.GetValue()),
+				int(camera.Width.GetValue()),
+				uint32_t(camera.PixelFormat.GetIntValue())
+			);
+	}
+	else
+		_buffers.reserve(
+			_images.capacity(),
+			camera.Height.GetValue(),
+			camera.Width.GetValue(),
+			_colour ? CV_8UC3 : CV_8UC1
+		);
+}
+
+void basler::image_listener::reset_statistics()
+{
+	_statistics.reset(_images.dropped());
+}
+
 [[nodiscard]]
 base::rotation_direction basler::image_listener::rotation() const
 {
@@ -61,11 +190,33 @@ void basler::image_listener::rotation(base::rotation_direction direction)
 	_rotation = direction;
 }
 
+[[nodiscard]]
+device_statistics::snapshot basler::image_listener::statistics() const
+{
+	return _statistics.take(_images.size(), _images.dropped());
+}
+
+void basler::image_listener::stopping(bool stopping)
+{
+	_images.stopping(stopping);
+}
+
+[[nodiscard]]
+bool basler::image_listener::zero_copy() const
+{
+	return _zero_copy;
+}
+
+void basler::image_listener::zero_copy(bool enable)
+{
+	_zero_copy = enable;
+}
+
 void basler::image_listener::OnImageEventHandlerRegistered(Pylon::CBaslerUniversalInstantCamera& camera)
 {
-	auto guard = std::lock_guard { _lock };
 	_images.clear();
 	_counter = 0;
+	_last_block_id.reset();
 }
 
 void basler::image_listener::OnImageGrabbed(
@@ -73,29 +224,83 @@ void basler::image_listener::OnImageGrabbed(
 	const Pylon::CBaslerUniversalGrabResultPtr& grabResult
 )
 {
+	const auto received = std::chrono::steady_clock::now();
+	_binder.bind();
 	Pylon::IImage& source_image = grabResult;
-	cv::Mat image;
+	const auto push = [&](base::frame frame)
+	{
+		frame.block_id = grabResult->GetBlockID();
+		frame.device_timestamp = grabResult->GetTimeStamp();
+		frame.host_timestamp = received;
+		frame.gap = _utils::gap(_last_block_id, frame.block_id);
+		_pyramid.build(frame);
+		const auto converted = std::chrono::steady_clock::now();
+		const auto gap = frame.gap;
+		_images.push(std::move(frame));
+		_statistics.record_callback(received, converted, gap);
+	};
+
+	// raw frames are only copied out of the grab buffer, if at all, leaving conversion and rotation to the consumer
+	if (_raw)
+		if (const auto format = _utils::gvsp_pixel_format(source_image.GetPixelType()))
+			if (auto view = _utils::raw_view(
+				source_image.GetBuffer(),
+				source_image.GetImageSize(),
+				source_image.GetHeight(),
+				source_image.GetWidth(),
+				*format
+			); !view.empty())
+			{
+				if (_zero_copy)
+					push({ 0, _utils::adopt(view, grabResult), *format });
+				else
+				{
+					cv::Mat output;
+					_buffers.acquire(output, view.rows, view.cols, view.type());
+					view.copyTo(output);
+					push({ 0, std::move(output), *format });
+				}
+				return;
+			}
+
+	const auto type = _colour ? CV_8UC3 : CV_8UC1;
+	const auto rotation = _rotation;
+
+	cv::Mat output;
 	if (_converter.ImageHasDestinationFormat(source_image))
 	{
 		size_t stride;
 		if (!source_image.GetStride(stride))
 			throw std::logic_error("failed to get the stride of BGR/Mono image");
-		cv::Mat(
+		cv::Mat view(
 			source_image.GetHeight(),
 			source_image.GetWidth(),
-			_colour ? CV_8UC3 : CV_8UC1,
+			type,
 			source_image.GetBuffer(),
 			stride
-		).copyTo(image);
+		);
+		// the grab buffer travels with the frame and is handed back to Pylon once the consumer releases it
+		if (_zero_copy && rotation == base::rotation_direction::ORIGINAL)
+			output = _utils::adopt(view, grabResult);
+		else
+			output = _utils::rotate(view, _buffers, rotation);
 	}
 	else
 	{
-		image.create(source_image.GetHeight(), source_image.GetWidth(), _colour ? CV_8UC3 : CV_8UC1);
+		// convert in place unless a rotation still has to follow
+		const bool direct = rotation == base::rotation_direction::ORIGINAL;
+		auto& image = direct ? output : _converted;
+		if (direct)
+			_buffers.acquire(image, source_image.GetHeight(), source_image.GetWidth(), type);
+		else
+			image.create(source_image.GetHeight(), source_image.GetWidth(), type);
 		_converter.Convert(image.data, image.total() * image.channels(), source_image);
+
+		if (!direct)
+			output = _utils::rotate(image, _buffers, rotation);
 	}
 
-	auto guard = std::lock_guard { _lock };
-	_utils::rotate(image, _images.emplace_back(), _rotation);
+	push({ 0, std::move(output) });
 }
 
 const basler::initialiser basler::_global_guard;
@@ -142,22 +347,229 @@ std::vector<std::unique_ptr<basler>> basler::find(
 	return ret;
 }
 
+namespace
+{
+
+// pylon reports through exceptions or a bare boolean, neither of which carries a code
+[[nodiscard]]
+static inline std::error_code _inaccessible() noexcept
+{
+	return std::make_error_code(std::errc::permission_denied);
+}
+
+static inline void _read_parameter(
+	GenApi::INodeMap& nodes,
+	const char *name,
+	parameter_value& value,
+	std::error_code& ec
+)
+{
+	ec.clear();
+	std::visit([&](auto& current)
+	{
+		using T = std::decay_t<decltype(current)>;
+		if constexpr (std::is_same_v<T, bool>)
+		{
+			Pylon::CBooleanParameter parameter(nodes, name);
+			if (parameter.IsReadable())
+				current = parameter.GetValue();
+			else
+				ec = _inaccessible();
+		}
+		else if constexpr (std::is_same_v<T, int64_t>)
+		{
+			Pylon::CIntegerParameter parameter(nodes, name);
+			if (parameter.IsReadable())
+				current = parameter.GetValue();
+			else
+				ec = _inaccessible();
+		}
+		else if constexpr (std::is_same_v<T, double>)
+		{
+			Pylon::CFloatParameter parameter(nodes, name);
+			if (parameter.IsReadable())
+				current = parameter.GetValue();
+			else
+				ec = _inaccessible();
+		}
+		else if constexpr (std::is_same_v<T, enumeration>)
+		{
+			Pylon::CEnumParameter parameter(nodes, name);
+			if (parameter.IsReadable())
+				current.symbol = parameter.GetValue().c_str();
+			else
+				ec = _inaccessible();
+		}
+		else
+		{
+			Pylon::CStringParameter parameter(nodes, name);
+			if (parameter.IsReadable())
+				current = parameter.GetValue().c_str();
+			else
+				ec = _inaccessible();
+		}
+	}, value);
+}
+
+static inline void _write_parameter(
+	GenApi::INodeMap& nodes,
+	const char *name,
+	const parameter_value& value,
+	std::error_code& ec
+)
+{
+	// values out of range throw rather than fail
+	bool written = false;
+	try
+	{
+		written = std::visit([&](const auto& target)
+		{
+			using T = std::decay_t<decltype(target)>;
+			if constexpr (std::is_same_v<T, bool>)
+				return Pylon::CBooleanParameter(nodes, name).TrySetValue(target);
+			else if constexpr (std::is_same_v<T, int64_t>)
+				return Pylon::CIntegerParameter(nodes, name).TrySetValue(target);
+			else if constexpr (std::is_same_v<T, double>)
+				return Pylon::CFloatParameter(nodes, name).TrySetValue(target);
+			else if constexpr (std::is_same_v<T, enumeration>)
+				return Pylon::CEnumParameter(nodes, name).TrySetValue(target.symbol.c_str());
+			else
+				return Pylon::CStringParameter(nodes, name).TrySetValue(target.c_str());
+		}, value);
+	}
+	catch (const GenICam::GenericException&)
+	{}
+	ec = written ? std::error_code {} : _inaccessible();
+}
+
+}
+
+[[nodiscard]]
+parameter_report basler::apply(const parameter_set& parameters)
+{
+	const bool restart = _instance.IsGrabbing();
+	if (restart)
+		stop();
+	auto& nodes = _instance.GetNodeMap();
+	auto ret = _utils::apply_parameters(
+		parameters,
+		[&nodes](const std::string& name, parameter_value& value, std::error_code& ec)
+		{
+			_read_parameter(nodes, name.c_str(), value, ec);
+		},
+		[&nodes](const std::string& name, const parameter_value& value, std::error_code& ec)
+		{
+			_write_parameter(nodes, name.c_str(), value, ec);
+		}
+	);
+	if (restart)
+		start();
+	return ret;
+}
+
+[[nodiscard]]
+const thread_affinity& basler::acquisition_thread() const
+{
+	return _listener.binder().affinity();
+}
+
+void basler::acquisition_thread(thread_affinity affinity)
+{
+	_listener.binder().affinity(std::move(affinity));
+}
+
 void basler::close()
 {
 	_instance.Close();
 }
 
+[[nodiscard]]
+bool basler::disconnected() const
+{
+	return _instance.IsCameraDeviceRemoved();
+}
+
+[[nodiscard]]
+size_t basler::dropped_frames() const
+{
+	return _listener.dropped();
+}
+
+void basler::listener(ring_listener *listener)
+{
+	_listener.listener(listener);
+}
+
 [[nodiscard]]
 base::frame basler::next_image(std::error_code& ec)
 {
 	return _listener.next(ec);
 }
 
+[[nodiscard]]
+base::frame basler::next_image(
+	std::error_code& ec,
+	std::stop_token token,
+	const std::chrono::nanoseconds& timeout
+)
+{
+	return _listener.next(ec, std::move(token), timeout);
+}
+
 void basler::open()
 {
 	_instance.Open();
 }
 
+[[nodiscard]]
+frame_pool& basler::pool()
+{
+	return _listener.buffers();
+}
+
+[[nodiscard]]
+size_t basler::pyramid() const
+{
+	return _listener.builder().levels();
+}
+
+void basler::pyramid(size_t levels)
+{
+	_listener.builder().levels(levels);
+}
+
+void basler::queue(size_t capacity, overflow_policy policy)
+{
+	_listener.queue(capacity, policy);
+}
+
+[[nodiscard]]
+bool basler::raw() const
+{
+	return _listener.raw();
+}
+
+void basler::raw(bool enable)
+{
+	_listener.raw(enable);
+}
+
+void basler::reconnect()
+{
+	// a removed device cannot be opened again, it is replaced by a new one of the same serial
+	Pylon::CDeviceInfo info;
+	info.SetSerialNumber(_instance.GetDeviceInfo().GetSerialNumber());
+	info.SetDeviceClass(_instance.GetDeviceInfo().GetDeviceClass());
+	_instance.DestroyDevice();
+	_instance.Attach(Pylon::CTlFactory::GetInstance().CreateFirstDevice(info));
+	_instance.Open();
+}
+
+void basler::reset_statistics()
+{
+	_listener.reset_statistics();
+}
+
 [[nodiscard]]
 base::rotation_direction basler::rotation() const
 {
@@ -178,12 +590,44 @@ std::string basler::serial() const
 
 void basler::start()
 {
+	_listener.reserve(_instance);
+	if (_listener.zero_copy())
+	{
+		// every queued frame may pin a grab buffer, leave some for the grab engine itself
+		const auto required = int64_t(_listener.capacity()) + 2;
+		if (_instance.MaxNumBuffer.GetValue() < required)
+			_instance.MaxNumBuffer.SetValue(required);
+	}
+	// the grab loop thread is bound by the listener, the internal grab engine one is only reachable through pylon
+	if (const auto& priority = _listener.binder().affinity().priority)
+	{
+		_instance.InternalGrabEngineThreadPriorityOverride.SetValue(true);
+		_instance.InternalGrabEngineThreadPriority.SetValue(*priority);
+	}
 	_instance.StartGrabbing(Pylon::GrabStrategy_OneByOne, Pylon::GrabLoop_ProvidedByInstantCamera);
 }
 
+[[nodiscard]]
+device_statistics::snapshot basler::statistics() const
+{
+	return _listener.statistics();
+}
+
 void basler::stop()
 {
-	_instance.StopGrabbing();
+	// a grab loop thread blocked on a full queue would otherwise keep the grab from stopping
+	_listener.stopping(true);
+	try
+	{
+		_instance.StopGrabbing();
+	}
+	catch (...)
+	{
+		_listener.stopping(false);
+		throw;
+	}
+	// no callback runs anymore once the grab has stopped
+	_listener.stopping(false);
 }
 
 void basler::subscribe()
@@ -264,9 +708,9 @@ namespace
 {
 
 static constexpr auto _trigger_lines = std::array {
-	Basler_UniversalCameraParams::TriggerSource_Line1,
-	Basler_UniversalCameraParams::TriggerSource_Line2,
-	Basler_UniversalCameraParams::TriggerSource_Line3
+	"Line1",
+	"Line2",
+	"Line3"
 };
 
 }
@@ -285,6 +729,7 @@ bool basler::trigger_delay_range(std::chrono::duration<double, std::micro>& min,
 [[nodiscard]]
 bool basler::set_manual_trigger_line_source(size_t line, const std::chrono::duration<double, std::micro>& delay)
 {
+	// written live rather than through apply, which would restart the grab and drop the queued frames
 	return line < _trigger_lines.size() &&
 		_instance.TriggerSelector.TrySetValue(Basler_UniversalCameraParams::TriggerSelector_FrameStart) &&
 		_instance.TriggerSource.TrySetValue(_trigger_lines[line]) &&
@@ -293,4 +738,71 @@ bool basler::set_manual_trigger_line_source(size_t line, const std::chrono::dura
 		_instance.TriggerMode.TrySetValue(Basler_UniversalCameraParams::TriggerMode_On);
 }
 
+[[nodiscard]]
+bool basler::zero_copy() const
+{
+	return _listener.zero_copy();
+}
+
+void basler::zero_copy(bool enable)
+{
+	_listener.zero_copy(enable);
+}
+
+namespace
+{
+
+[[nodiscard]]
+static inline bool _get_integer(Pylon::CBaslerUniversalInstantCamera& camera, const char *name, _utils::integer_node& node)
+{
+	Pylon::CIntegerParameter parameter(camera.GetNodeMap(), name);
+	if (!parameter.IsReadable())
+		return false;
+	node = { parameter.GetValue(), parameter.GetMin(), parameter.GetMax(), parameter.GetInc() };
+	return true;
+}
+
+[[nodiscard]]
+static inline bool _set_integer(Pylon::CBaslerUniversalInstantCamera& camera, const char *name, int64_t value)
+{
+	return Pylon::CIntegerParameter(camera.GetNodeMap(), name).TrySetValue(value);
+}
+
+}
+
+[[nodiscard]]
+bool basler::roi(cv::Rect& roi)
+{
+	return _utils::read_roi(roi, [this](const char *name, _utils::integer_node& node)
+	{
+		return _get_integer(_instance, name, node);
+	});
+}
+
+[[nodiscard]]
+bool basler::set_binning(size_t horizontal, size_t vertical)
+{
+	return horizontal && vertical &&
+		_instance.BinningHorizontal.TrySetValue(int64_t(horizontal)) &&
+		_instance.BinningVertical.TrySetValue(int64_t(vertical));
+}
+
+[[nodiscard]]
+bool basler::set_decimation(size_t horizontal, size_t vertical)
+{
+	return horizontal && vertical &&
+		_instance.DecimationHorizontal.TrySetValue(int64_t(horizontal)) &&
+		_instance.DecimationVertical.TrySetValue(int64_t(vertical));
+}
+
+[[nodiscard]]
+bool basler::set_roi(const cv::Rect& roi)
+{
+	return _utils::apply_roi(
+		roi,
+		[this](const char *name, _utils::integer_node& node) { return _get_integer(_instance, name, node); },
+		[this](const char *name, int64_t value) { return _set_integer(_instance, name, value); }
+	);
+}
+
 }
@@ -0,0 +1,79 @@
+#ifndef __UTILITIES_CAMERA_CONTAINER_HPP__
+#define __UTILITIES_CAMERA_CONTAINER_HPP__
+
+#include <cstddef>
+#include <cstdint>
+
+namespace utilities::camera::_container
+{
+
+// Layout of a recording, in native byte order:
+// - a file_header
+// - one record_header per frame then its payload, each starting on a 64-byte boundary
+// - on a clean close, one index_entry per frame then a trailer ending the file
+// A recording cut short by a crash has no trailer, its records are then found by walking the headers.
+
+static constexpr char file_magic[8] = { 'C', 'A', 'M', 'R', 'E', 'C', '0', '1' };
+
+static constexpr char index_magic[8] = { 'C', 'A', 'M', 'I', 'D', 'X', '0', '1' };
+
+// "FRAM"
+static constexpr uint32_t record_magic = 0x4D415246;
+
+static constexpr size_t alignment = 64;
+
+struct file_header final
+{
+	char magic[8];
+	// clocks read together when the recording was created, relating host timestamps to wall time
+	int64_t steady_origin;
+	int64_t system_origin;
+	uint32_t brand;
+	uint32_t reserved;
+	char serial[64];
+};
+
+struct record_header final
+{
+	uint32_t magic;
+	uint32_t encoding;
+	uint64_t id;
+	uint64_t block_id;
+	uint64_t device_timestamp;
+	// steady clock, in nanoseconds
+	int64_t host_timestamp;
+	uint64_t gap;
+	int32_t rows;
+	int32_t cols;
+	int32_t type;
+	uint8_t layout;
+	uint8_t depth;
+	uint8_t packed;
+	uint8_t reserved;
+	// bytes of the payload, continuous rows when not encoded
+	uint64_t size;
+};
+
+struct index_entry final
+{
+	uint64_t id;
+	int64_t host_timestamp;
+	uint64_t offset;
+};
+
+struct trailer final
+{
+	uint64_t count;
+	uint64_t offset;
+	char magic[8];
+};
+
+[[nodiscard]]
+inline constexpr uint64_t align(uint64_t value) noexcept
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+}
+
+#endif
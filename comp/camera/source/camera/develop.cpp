@@ -0,0 +1,182 @@
+#include <cstddef>
+#include <cstdint>
+
+#include <stdexcept>
+#include <type_traits>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "utilities/camera/base.hpp"
+#include "utilities/camera/develop.hpp"
+
+#include "./utils.hpp"
+
+namespace utilities::camera
+{
+
+namespace
+{
+
+[[nodiscard]]
+static inline cv::Rect _region(const base::frame& frame, const cv::Rect& roi)
+{
+	const auto& content = frame.content;
+	// 3 bytes per pair of samples, and 2 for a trailing odd one, which rounding down still counts
+	const cv::Rect whole(0, 0, frame.format.packed ? content.cols * 2 / 3 : content.cols, content.rows);
+	if (roi.empty())
+		return whole;
+	if ((roi & whole) != roi)
+		throw std::invalid_argument("region of interest out of the frame");
+	return roi;
+}
+
+// Packed pairs of samples (a, b) are laid out as:
+// - byte 0: the most significant bits of a
+// - byte 1: the least significant bits of a in the low nibble, those of b in the high nibble
+// - byte 2: the most significant bits of b
+template<bool eight_bit>
+static inline void _unpack(const cv::Mat& content, size_t depth, const cv::Rect& region, cv::Mat& output)
+{
+	using sample_type = std::conditional_t<eight_bit, uint8_t, uint16_t>;
+	const auto low_bits = depth - 8;
+	const auto low_mask = (1 << low_bits) - 1;
+
+	output.create(region.height, region.width, eight_bit ? CV_8UC1 : CV_16UC1);
+	for (int r = 0; r < region.height; ++r)
+	{
+		auto source = content.ptr<uint8_t>(region.y + r);
+		auto destination = output.ptr<sample_type>(r);
+		for (int c = 0; c < region.width; ++c)
+		{
+			const auto x = region.x + c;
+			auto pair = source + x / 2 * 3;
+			if constexpr (eight_bit)
+				destination[c] = pair[x % 2 ? 2 : 0];
+			else if (x % 2)
+				destination[c] = (pair[2] << low_bits) | ((pair[1] >> 4) & low_mask);
+			else
+				destination[c] = (pair[0] << low_bits) | (pair[1] & low_mask);
+		}
+	}
+}
+
+[[nodiscard]]
+static inline base::pixel_layout _shift(base::pixel_layout layout, const cv::Point& origin)
+{
+	using enum base::pixel_layout;
+	if (origin.x % 2)
+		switch (layout)
+		{
+			case BAYER_BG:
+				layout = BAYER_GB;
+				break;
+			case BAYER_GB:
+				layout = BAYER_BG;
+				break;
+			case BAYER_GR:
+				layout = BAYER_RG;
+				break;
+			case BAYER_RG:
+				layout = BAYER_GR;
+				break;
+			default:
+				break;
+		}
+	if (origin.y % 2)
+		switch (layout)
+		{
+			case BAYER_BG:
+				layout = BAYER_GR;
+				break;
+			case BAYER_GB:
+				layout = BAYER_RG;
+				break;
+			case BAYER_GR:
+				layout = BAYER_BG;
+				break;
+			case BAYER_RG:
+				layout = BAYER_GB;
+				break;
+			default:
+				break;
+		}
+	return layout;
+}
+
+// OpenCV names bayer patterns after the second and third pixels of the second row
+[[nodiscard]]
+static inline int _demosaic_code(base::pixel_layout layout, bool colour)
+{
+	switch (layout)
+	{
+		case base::pixel_layout::BAYER_BG:
+			return colour ? cv::COLOR_BayerRG2BGR : cv::COLOR_BayerRG2GRAY;
+		case base::pixel_layout::BAYER_GB:
+			return colour ? cv::COLOR_BayerGR2BGR : cv::COLOR_BayerGR2GRAY;
+		case base::pixel_layout::BAYER_GR:
+			return colour ? cv::COLOR_BayerGB2BGR : cv::COLOR_BayerGB2GRAY;
+		case base::pixel_layout::BAYER_RG:
+			return colour ? cv::COLOR_BayerBG2BGR : cv::COLOR_BayerBG2GRAY;
+		default:
+			throw std::invalid_argument("not a bayer pattern");
+	}
+}
+
+}
+
+void develop(
+	const base::frame& frame,
+	cv::Mat& output,
+	bool colour,
+	base::rotation_direction rotation,
+	const cv::Rect& roi
+)
+{
+	const auto& format = frame.format;
+	const auto region = _region(frame, roi);
+
+	// 8-bit samples, still mosaicked
+	cv::Mat samples;
+	if (format.packed)
+		_unpack<true>(frame.content, format.depth, region, samples);
+	else if (format.depth > 8)
+		frame.content(region).convertTo(samples, CV_8U, 1.0 / (1 << (format.depth - 8)));
+	else
+		samples = frame.content(region);
+
+	cv::Mat image;
+	switch (format.layout)
+	{
+		case base::pixel_layout::MONO:
+			if (colour)
+				cv::cvtColor(samples, image, cv::COLOR_GRAY2BGR);
+			else
+				image = samples;
+			break;
+		case base::pixel_layout::BGR:
+			if (colour)
+				image = samples;
+			else
+				cv::cvtColor(samples, image, cv::COLOR_BGR2GRAY);
+			break;
+		default:
+			cv::cvtColor(samples, image, _demosaic_code(_shift(format.layout, region.tl()), colour));
+	}
+
+	if (rotation == base::rotation_direction::ORIGINAL)
+		output = image;
+	else
+		_utils::rotate(image, output, rotation);
+}
+
+void unpack(const base::frame& frame, cv::Mat& output, const cv::Rect& roi)
+{
+	const auto region = _region(frame, roi);
+	if (frame.format.packed)
+		_unpack<false>(frame.content, frame.format.depth, region, output);
+	else
+		output = frame.content(region);
+}
+
+}
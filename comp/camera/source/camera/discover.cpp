@@ -0,0 +1,215 @@
+#include <cstddef>
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "utilities/camera/base.hpp"
+#include "utilities/camera/basler.hpp"
+#include "utilities/camera/discover.hpp"
+#include "utilities/camera/fake.hpp"
+#include "utilities/camera/hikvision.hpp"
+#include "utilities/camera/huaray.hpp"
+#include "utilities/camera/parameters.hpp"
+
+namespace utilities::camera
+{
+
+namespace
+{
+
+template<typename T>
+static inline void _append(std::vector<std::unique_ptr<base::device>>& devices, std::vector<std::unique_ptr<T>> found)
+{
+	for (auto& device : found)
+		devices.emplace_back(std::move(device));
+}
+
+// transport layers of a single SDK are enumerated one after the other, their device lists being SDK-wide state
+[[nodiscard]]
+static std::vector<std::unique_ptr<base::device>> _find_hikvision(const std::vector<std::string>& serials, bool colour)
+{
+	std::vector<std::unique_ptr<base::device>> ret;
+	_append(ret, hikvision::find(serials, hikvision::transport_layer::GIG_E, colour));
+	_append(ret, hikvision::find(serials, hikvision::transport_layer::USB, colour));
+	return ret;
+}
+
+[[nodiscard]]
+static std::vector<std::unique_ptr<base::device>> _find_huaray(const std::vector<std::string>& serials, bool colour)
+{
+	std::vector<std::unique_ptr<base::device>> ret;
+	_append(ret, huaray::find(serials, huaray::transport_layer::GIG_E, colour));
+	_append(ret, huaray::find(serials, huaray::transport_layer::USB, colour));
+	return ret;
+}
+
+[[nodiscard]]
+static std::vector<std::unique_ptr<base::device>> _find_basler(const std::vector<std::string>& serials, bool colour)
+{
+	// the serials outlive the enumeration
+	const std::vector<std::string_view> views(serials.begin(), serials.end());
+	std::vector<std::unique_ptr<base::device>> ret;
+	_append(ret, basler::find(views, basler::transport_layer::ANY, colour));
+	return ret;
+}
+
+[[nodiscard]]
+static std::vector<std::unique_ptr<base::device>> _find_fake(
+	const std::vector<std::string>& serials,
+	bool colour,
+	const std::filesystem::path& base,
+	const std::chrono::nanoseconds& interval
+)
+{
+	std::vector<std::string> names { serials };
+	if (names.empty())
+		for (const auto& entry : std::filesystem::directory_iterator(base))
+			if (entry.is_directory())
+				names.push_back(entry.path().filename().string());
+
+	std::vector<std::unique_ptr<base::device>> ret;
+	_append(ret, fake::find(base, std::move(names), colour, interval));
+	return ret;
+}
+
+}
+
+[[nodiscard]]
+discovery discover(
+	const std::vector<std::string>& serials,
+	bool colour,
+	const std::filesystem::path& fake_base,
+	const std::chrono::nanoseconds& fake_interval
+)
+{
+	using result_type = std::vector<std::unique_ptr<base::device>>;
+	std::vector<std::pair<base::brand, std::future<result_type>>> tasks;
+	tasks.emplace_back(base::brand::HIKVISION, std::async(std::launch::async, _find_hikvision, std::cref(serials), colour));
+	tasks.emplace_back(base::brand::HUARAY, std::async(std::launch::async, _find_huaray, std::cref(serials), colour));
+	tasks.emplace_back(base::brand::BASLER, std::async(std::launch::async, _find_basler, std::cref(serials), colour));
+	if (!fake_base.empty())
+		tasks.emplace_back(
+			base::brand::UNKNOWN,
+			std::async(std::launch::async, _find_fake, std::cref(serials), colour, std::cref(fake_base), std::cref(fake_interval))
+		);
+
+	discovery ret;
+	for (auto& [brand, task] : tasks)
+	{
+		try
+		{
+			_append(ret.devices, task.get());
+		}
+		catch (...)
+		{
+			ret.failures.emplace_back(brand, std::current_exception());
+		}
+	}
+
+	if (!serials.empty())
+	{
+		std::unordered_map<std::string, size_t> order;
+		for (size_t i = 0; i < serials.size(); ++i)
+			order.emplace(serials[i], i);
+		std::vector<std::pair<size_t, std::unique_ptr<base::device>>> ranked;
+		ranked.reserve(ret.devices.size());
+		for (auto& device : ret.devices)
+		{
+			const auto rank = order.find(device->serial());
+			ranked.emplace_back(rank == order.end() ? serials.size() : rank->second, std::move(device));
+		}
+		std::stable_sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+		for (size_t i = 0; i < ranked.size(); ++i)
+			ret.devices[i] = std::move(ranked[i].second);
+	}
+	return ret;
+}
+
+[[nodiscard]]
+std::vector<std::exception_ptr> for_each_device(
+	std::vector<std::unique_ptr<base::device>>& devices,
+	const std::function<void(base::device&)>& operation
+)
+{
+	std::vector<std::future<void>> tasks;
+	tasks.reserve(devices.size());
+	for (auto& device : devices)
+		tasks.push_back(std::async(std::launch::async, [&operation, &device] { operation(*device); }));
+
+	std::vector<std::exception_ptr> ret(devices.size());
+	for (size_t i = 0; i < tasks.size(); ++i)
+	{
+		try
+		{
+			tasks[i].get();
+		}
+		catch (...)
+		{
+			ret[i] = std::current_exception();
+		}
+	}
+	return ret;
+}
+
+[[nodiscard]]
+std::vector<std::exception_ptr> open_all(std::vector<std::unique_ptr<base::device>>& devices)
+{
+	return for_each_device(devices, [](base::device& device) { device.open(); });
+}
+
+[[nodiscard]]
+std::vector<std::exception_ptr> start_all(std::vector<std::unique_ptr<base::device>>& devices)
+{
+	return for_each_device(devices, [](base::device& device)
+	{
+		device.subscribe();
+		device.start();
+	});
+}
+
+[[nodiscard]]
+std::vector<std::exception_ptr> stop_all(std::vector<std::unique_ptr<base::device>>& devices)
+{
+	return for_each_device(devices, [](base::device& device)
+	{
+		device.stop();
+		device.unsubscribe();
+	});
+}
+
+[[nodiscard]]
+std::vector<std::exception_ptr> close_all(std::vector<std::unique_ptr<base::device>>& devices)
+{
+	return for_each_device(devices, [](base::device& device) { device.close(); });
+}
+
+[[nodiscard]]
+std::vector<std::exception_ptr> apply_all(
+	std::vector<std::unique_ptr<base::device>>& devices,
+	const parameter_set& parameters,
+	std::vector<parameter_report>& reports
+)
+{
+	reports.assign(devices.size(), {});
+	return for_each_device(devices, [&](base::device& device)
+	{
+		const auto index = size_t(std::find_if(
+			devices.begin(),
+			devices.end(),
+			[&device](const auto& current) { return current.get() == &device; }
+		) - devices.begin());
+		reports[index] = device.apply(parameters);
+	});
+}
+
+}
@@ -0,0 +1,135 @@
+#include <cstddef>
+
+#include <algorithm>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "utilities/camera/event_loop.hpp"
+
+namespace utilities::camera
+{
+
+void event_loop::_execute(task *task) noexcept
+{
+	task->run();
+
+	auto guard = std::lock_guard { _lock };
+	const auto entry = std::find(_running.begin(), _running.end(), std::pair { task, std::this_thread::get_id() });
+	*entry = _running.back();
+	_running.pop_back();
+	if (_cancelling)
+		_finished.notify_all();
+}
+
+[[nodiscard]]
+event_loop::task *event_loop::_take() noexcept
+{
+	auto ret = _queue[_head];
+	_head = (_head + 1) & (_queue.size() - 1);
+	--_count;
+	return ret;
+}
+
+event_loop::event_loop() :
+	_lock {},
+	_available {},
+	_queue(16),
+	_head(0),
+	_count(0),
+	_running {},
+	_finished {},
+	_cancelling(0)
+{
+	// as many threads as likely to run the loop, so that the runs hardly ever allocate
+	_running.reserve(std::max(std::thread::hardware_concurrency(), 1u));
+}
+
+void event_loop::cancel(task *task)
+{
+	auto guard = std::unique_lock { _lock };
+	const auto mask = _queue.size() - 1;
+	size_t kept = 0;
+	for (size_t i = 0; i < _count; ++i)
+	{
+		auto current = _queue[(_head + i) & mask];
+		if (current != task)
+			_queue[(_head + kept++) & mask] = current;
+	}
+	_count = kept;
+
+	// a task cancelling itself from within its own run cannot wait for it
+	const auto running_elsewhere = [this, task, self = std::this_thread::get_id()]
+	{
+		return std::any_of(
+			_running.begin(),
+			_running.end(),
+			[&](const auto& entry) { return entry.first == task && entry.second != self; }
+		);
+	};
+	++_cancelling;
+	_finished.wait(guard, [&] { return !running_elsewhere(); });
+	--_cancelling;
+}
+
+[[nodiscard]]
+size_t event_loop::pending() const
+{
+	auto guard = std::lock_guard { _lock };
+	return _count;
+}
+
+size_t event_loop::poll()
+{
+	size_t ret = 0;
+	while (true)
+	{
+		task *current;
+		{
+			auto guard = std::lock_guard { _lock };
+			if (!_count)
+				return ret;
+			current = _take();
+			_running.emplace_back(current, std::this_thread::get_id());
+		}
+		_execute(current);
+		++ret;
+	}
+}
+
+void event_loop::post(task *task)
+{
+	{
+		auto guard = std::lock_guard { _lock };
+		if (_count == _queue.size())
+		{
+			std::vector<event_loop::task *> grown(_queue.size() * 2);
+			for (size_t i = 0; i < _count; ++i)
+				grown[i] = _queue[(_head + i) & (_queue.size() - 1)];
+			_queue = std::move(grown);
+			_head = 0;
+		}
+		_queue[(_head + _count++) & (_queue.size() - 1)] = task;
+	}
+	_available.notify_one();
+}
+
+void event_loop::run(std::stop_token token)
+{
+	while (true)
+	{
+		task *current;
+		{
+			auto guard = std::unique_lock { _lock };
+			if (!_available.wait(guard, token, [this] { return _count > 0; }))
+				return;
+			current = _take();
+			_running.emplace_back(current, std::this_thread::get_id());
+		}
+		_execute(current);
+	}
+}
+
+}
@@ -1,26 +1,40 @@
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <condition_variable>
 #include <filesystem>
+#include <fstream>
+#include <future>
+#include <limits>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <random>
+#include <stdexcept>
 #include <stop_token>
+#include <string>
+#include <system_error>
 #include <thread>
 #include <unordered_set>
+#include <utility>
+#include <variant>
 #include <vector>
 
+#include <mio/mmap.hpp>
 #include <opencv2/core.hpp>
 #include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
 
 #include "utilities/camera/base.hpp"
 #include "utilities/camera/fake.hpp"
 
 #include "./utils.hpp"
 
-using std::chrono_literals::operator""ms;
-
 namespace utilities::camera
 {
 
@@ -33,60 +47,416 @@ static const std::unordered_set<std::string> _accepted_extension {
 	".png"
 };
 
+// sorted so that replays are reproducible whatever the order of the file system
 [[nodiscard]]
-static std::vector<cv::Mat> _load_images(const std::filesystem::path& directory, bool colour)
+static std::vector<std::filesystem::path> _list_images(const std::filesystem::path& directory)
 {
-	const auto read_mode = colour ? cv::IMREAD_COLOR : cv::IMREAD_GRAYSCALE;
-	std::vector<cv::Mat> images;
+	std::vector<std::filesystem::path> paths;
 	for (const auto& entry : std::filesystem::directory_iterator(directory))
 	{
 		if (entry.is_regular_file())
 			if (const auto& path = entry.path(); _accepted_extension.count(path.extension().string()))
-				images.push_back(cv::imread(path.string(), read_mode));
+				paths.push_back(path);
+	}
+	std::sort(paths.begin(), paths.end());
+	return paths;
+}
+
+[[nodiscard]]
+static inline cv::Mat _read_image(const std::filesystem::path& path, bool colour)
+{
+	return cv::imread(path.string(), colour ? cv::IMREAD_COLOR : cv::IMREAD_GRAYSCALE);
+}
+
+[[nodiscard]]
+static std::vector<cv::Mat> _decode_images(const std::vector<std::filesystem::path>& paths, bool colour)
+{
+	std::vector<cv::Mat> images(paths.size());
+	cv::parallel_for_(cv::Range(0, int(paths.size())), [&](const cv::Range& range)
+	{
+		for (int i = range.start; i < range.end; ++i)
+			images[i] = _read_image(paths[i], colour);
+	});
+	return images;
+}
+
+// FNV-1a over the names and bytes of the images, plus the read mode
+[[nodiscard]]
+static uint64_t _hash_images(const std::vector<std::filesystem::path>& paths, bool colour)
+{
+	uint64_t ret = 0xCBF29CE484222325;
+	const auto feed = [&](const char *data, size_t size)
+	{
+		for (size_t i = 0; i < size; ++i)
+			ret = (ret ^ uint8_t(data[i])) * 0x100000001B3;
+	};
+
+	feed(colour ? "c" : "g", 1);
+	std::vector<char> buffer(1 << 16);
+	for (const auto& path : paths)
+	{
+		const auto name = path.filename().string();
+		feed(name.data(), name.size() + 1);
+		std::ifstream file(path, std::ios::binary);
+		while (file.read(buffer.data(), buffer.size()) || file.gcount())
+			feed(buffer.data(), file.gcount());
+	}
+	return ret;
+}
+
+static constexpr char _cache_magic[8] = { 'F', 'A', 'K', 'E', 'P', 'I', 'X', '1' };
+
+static constexpr size_t _cache_alignment = 64;
+
+struct cache_entry final
+{
+	int32_t rows;
+	int32_t cols;
+	int32_t type;
+	int32_t reserved;
+	uint64_t offset;
+};
+
+// Maps a cache file of decoded images, whose layout is:
+// - the magic and the number of images as a 64-bit integer
+// - one cache_entry per image
+// - the continuous pixels of each image, aligned on 64 bytes
+// Images reference the mapping, which is released with the last of them; an empty vector is returned on mismatch.
+[[nodiscard]]
+static std::vector<cv::Mat> _map_cache(const std::filesystem::path& path, size_t count)
+{
+	std::error_code ec;
+	auto mapping = std::make_shared<mio::mmap_source>();
+	mapping->map(path.string(), ec);
+	if (ec)
+		return {};
+
+	const auto data = mapping->data();
+	const auto size = mapping->size();
+	const auto header_size = sizeof(_cache_magic) + sizeof(uint64_t) + count * sizeof(cache_entry);
+	uint64_t stored_count;
+	if (size < header_size || std::memcmp(data, _cache_magic, sizeof(_cache_magic)))
+		return {};
+	std::memcpy(&stored_count, data + sizeof(_cache_magic), sizeof(stored_count));
+	if (stored_count != count)
+		return {};
+
+	std::vector<cv::Mat> images;
+	images.reserve(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		cache_entry entry;
+		std::memcpy(&entry, data + sizeof(_cache_magic) + sizeof(uint64_t) + i * sizeof(cache_entry), sizeof(entry));
+		if (!entry.rows || !entry.cols)
+		{
+			images.emplace_back();
+			continue;
+		}
+
+		const size_t bytes = size_t(entry.rows) * entry.cols * CV_ELEM_SIZE(entry.type);
+		if (entry.offset > size || size - entry.offset < bytes)
+			return {};
+		// read-only pages, like the storage shared by zero copy frames
+		const cv::Mat view(entry.rows, entry.cols, entry.type, const_cast<char *>(data + entry.offset));
+		images.push_back(_utils::adopt(view, mapping));
 	}
 	return images;
 }
 
+// written aside then renamed, so that concurrent rigs never map a partial file
+static void _write_cache(const std::filesystem::path& path, const std::vector<cv::Mat>& images)
+{
+	// random rather than derived from the thread, which other processes building the same cache may share
+	static thread_local std::mt19937_64 random { std::random_device {}() };
+	auto temporary = path;
+	temporary += _UTILITIES_FORMAT_STRING(".{}.tmp", random());
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		const uint64_t count = images.size();
+		file.write(_cache_magic, sizeof(_cache_magic));
+		file.write(reinterpret_cast<const char *>(&count), sizeof(count));
+
+		auto offset = sizeof(_cache_magic) + sizeof(count) + count * sizeof(cache_entry);
+		const auto align = [](size_t value) { return (value + _cache_alignment - 1) / _cache_alignment * _cache_alignment; };
+		for (const auto& image : images)
+		{
+			offset = align(offset);
+			const cache_entry entry { image.rows, image.cols, image.type(), 0, offset };
+			file.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+			offset += image.total() * image.elemSize();
+		}
+
+		const char padding[_cache_alignment] {};
+		for (const auto& image : images)
+		{
+			const size_t position = file.tellp();
+			file.write(padding, align(position) - position);
+			// decoded images are always continuous
+			file.write(reinterpret_cast<const char *>(image.data), image.total() * image.elemSize());
+		}
+		if (!file)
+		{
+			file.close();
+			std::error_code ec;
+			std::filesystem::remove(temporary, ec);
+			return;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(temporary, path, ec);
+	if (ec)
+		std::filesystem::remove(temporary, ec);
+}
+
+[[nodiscard]]
+static std::vector<cv::Mat> _load_images(
+	const std::vector<std::filesystem::path>& paths,
+	bool colour,
+	const std::filesystem::path& cache_directory
+)
+{
+	if (cache_directory.empty())
+		return _decode_images(paths, colour);
+
+	const auto cache = cache_directory / _UTILITIES_FORMAT_STRING("{:016x}.frames", _hash_images(paths, colour));
+	if (auto images = _map_cache(cache, paths.size()); !images.empty() || paths.empty())
+		return images;
+
+	auto images = _decode_images(paths, colour);
+	std::error_code ec;
+	std::filesystem::create_directories(cache_directory, ec);
+	_write_cache(cache, images);
+	return images;
+}
+
+// samples a BGR image the way a colour sensor with an RGGB filter array would
+[[nodiscard]]
+static cv::Mat _mosaic(const cv::Mat& image, frame_pool& pool)
+{
+	cv::Mat ret;
+	pool.acquire(ret, image.rows, image.cols, CV_8UC1);
+	for (int r = 0; r < image.rows; ++r)
+	{
+		auto source = image.ptr<uint8_t>(r);
+		auto destination = ret.ptr<uint8_t>(r);
+		for (int c = 0; c < image.cols; ++c)
+		{
+			// BGR channel indices of R G / G B
+			const int channel = r % 2 ? (c % 2 ? 0 : 1) : (c % 2 ? 1 : 2);
+			destination[c] = source[c * 3 + channel];
+		}
+	}
+	return ret;
+}
+
+struct trigger_line final
+{
+	std::mutex lock;
+	std::condition_variable_any signal;
+	uint64_t pulses;
+	std::chrono::steady_clock::time_point time;
+};
+
+static std::array<trigger_line, 4> _trigger_lines {};
+
 }
 
 fake::fake(
 	const std::filesystem::path& base,
 	std::string serial,
 	bool colour,
-	std::chrono::milliseconds interval
+	const std::chrono::nanoseconds& interval,
+	loading mode,
+	const std::filesystem::path& cache_directory
 ) :
 	device {},
-	_pool { _load_images(base / serial, colour) },
+	_paths { _list_images(base / serial) },
+	_pool { mode == loading::EAGER ? _load_images(_paths, colour, cache_directory) : std::vector<cv::Mat> {} },
+	_loading {},
+	_rotated {},
+	_rotated_direction(base::rotation_direction::ORIGINAL),
+	_colour(colour),
 	_serial { std::move(serial) },
+	_raw(false),
 	_rotation(base::rotation_direction::ORIGINAL),
+	_binning(1, 1),
+	_decimation(1, 1),
+	_roi {},
 	_index(0),
-	_interval(std::move(interval)),
-	_lock {},
+	_interval(interval),
+	_jitter {},
+	_seed(0),
+	_buffers {},
 	_images {},
 	_counter(0),
+	_statistics {},
+	_binder {},
+	_pyramid {},
+	_zero_copy(false),
+	_trigger_line {},
+	_trigger_delay {},
 	_stop {},
 	_simulation {}
-{}
+{
+	// the vector is only touched again once the loading is waited for
+	if (mode == loading::BACKGROUND)
+		_loading = std::async(std::launch::async, [this, colour, cache_directory]
+		{
+			_pool = _load_images(_paths, colour, cache_directory);
+		});
+}
+
+void fake::_wait_loaded()
+{
+	// rethrows any loading failure
+	if (_loading.valid())
+		_loading.get();
+}
+
+[[nodiscard]]
+bool fake::_windowed() const noexcept
+{
+	return _binning != cv::Size(1, 1) || _decimation != cv::Size(1, 1) || !_roi.empty();
+}
+
+[[nodiscard]]
+cv::Mat fake::_window(const cv::Mat& image) const
+{
+	auto ret = image;
+	for (const auto& [factor, interpolation] : {
+		std::pair { _binning, cv::INTER_AREA },
+		std::pair { _decimation, cv::INTER_NEAREST }
+	})
+	{
+		if (factor == cv::Size(1, 1))
+			continue;
+		// trailing pixels not filling a whole bin are lost, as on a sensor
+		const cv::Size size(ret.cols / factor.width, ret.rows / factor.height);
+		cv::Mat scaled;
+		cv::resize(ret(cv::Rect(0, 0, size.width * factor.width, size.height * factor.height)), scaled, size, 0, 0, interpolation);
+		ret = scaled;
+	}
+
+	const auto roi = _roi & cv::Rect(0, 0, ret.cols, ret.rows);
+	return roi.empty() ? ret : ret(roi);
+}
+
+[[nodiscard]]
+int *fake::_node(const std::string& name) noexcept
+{
+	if (name == "BinningHorizontal")
+		return &_binning.width;
+	if (name == "BinningVertical")
+		return &_binning.height;
+	if (name == "DecimationHorizontal")
+		return &_decimation.width;
+	if (name == "DecimationVertical")
+		return &_decimation.height;
+	if (name == "OffsetX")
+		return &_roi.x;
+	if (name == "OffsetY")
+		return &_roi.y;
+	if (name == "Width")
+		return &_roi.width;
+	if (name == "Height")
+		return &_roi.height;
+	return nullptr;
+}
+
+void fake::_emit(uint64_t block_id, size_t gap, std::chrono::steady_clock::time_point exposure)
+{
+	const auto received = std::chrono::steady_clock::now();
+	const auto index = _index++;
+	if (_index == _paths.size())
+		_index = 0;
+
+	// lazily loaded images are decoded for this frame only, so they never need to be copied
+	const bool owned = _pool.empty();
+	const auto image = owned ? _read_image(_paths[index], _colour) : _pool[index];
+	const auto rotation = _raw ? base::rotation_direction::ORIGINAL : _rotation;
+	base::frame frame;
+	if (_raw && image.channels() == 3)
+		frame = { 0, _mosaic(_window(image), _buffers), { base::pixel_layout::BAYER_RG, 8, false } };
+	// neither the prepared rotations nor the shared images are windowed
+	else if (_windowed())
+		frame = { 0, _utils::rotate(_window(image), _buffers, rotation) };
+	else if (!_rotated.empty() && rotation == _rotated_direction)
+		frame = { 0, _rotated[index] };
+	else if (rotation == base::rotation_direction::ORIGINAL && (_zero_copy || owned))
+		frame = { 0, image };
+	else
+		frame = { 0, _utils::rotate(image, _buffers, rotation) };
+	// the host clock stands in for the device one
+	frame.block_id = block_id;
+	frame.device_timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(exposure.time_since_epoch()).count();
+	frame.host_timestamp = received;
+	frame.gap = gap;
+	_pyramid.build(frame);
+	const auto converted = std::chrono::steady_clock::now();
+	_images.push(std::move(frame));
+	_statistics.record_callback(received, converted, gap);
+}
 
 void fake::_simulate(std::stop_token token)
 {
-	if (_pool.empty())
+	if (_paths.empty())
 		return;
+	_binder.bind();
+
+	if (!_trigger_line)
+	{
+		// the schedule is anchored to the start so that neither production time nor jitter accumulate
+		std::mt19937_64 random(_seed);
+		const auto start = std::chrono::steady_clock::now();
+		for (uint64_t block_id = 1; !token.stop_requested(); ++block_id)
+		{
+			if (!_interval.count())
+			{
+				_emit(block_id, 0, std::chrono::steady_clock::now());
+				// only a blocking queue holds the production back, a dropping one would keep the core spinning
+				if (_images.policy() != overflow_policy::BLOCK)
+					std::this_thread::yield();
+				continue;
+			}
 
-	while (!token.stop_requested())
+			auto exposure = start + _interval * int64_t(block_id - 1);
+			// below half the interval, so that consecutive frames never swap
+			const auto amplitude = std::min(_jitter.count(), (_interval.count() - 1) / 2);
+			// mapped by hand, the standard distributions are not reproducible across implementations
+			if (amplitude > 0)
+				exposure += std::chrono::nanoseconds(int64_t(random() % (2 * uint64_t(amplitude) + 1)) - amplitude);
+			if (!_utils::sleep_until(token, exposure))
+				return;
+			_emit(block_id, 0, exposure);
+		}
+		return;
+	}
+
+	auto& line = _trigger_lines[*_trigger_line];
+	uint64_t seen;
+	{
+		auto guard = std::lock_guard { line.lock };
+		seen = line.pulses;
+	}
+	while (true)
 	{
-		auto now = std::chrono::steady_clock::now();
-		while (std::chrono::steady_clock::now() - now < _interval)
+		uint64_t pulse;
+		std::chrono::steady_clock::time_point time;
 		{
-			std::this_thread::sleep_for(1ms);
-			if (token.stop_requested())
+			auto guard = std::unique_lock { line.lock };
+			if (!line.signal.wait(guard, token, [&] { return line.pulses != seen; }))
 				return;
+			pulse = line.pulses;
+			time = line.time;
 		}
 
-		auto guard = std::lock_guard { _lock };
-		_utils::rotate(_pool[_index++], _images.emplace_back(), _rotation);
-		if (_index == _pool.size())
-			_index = 0;
+		const auto exposure = time + std::chrono::duration_cast<std::chrono::steady_clock::duration>(_trigger_delay);
+		if (!_utils::sleep_until(token, exposure))
+			return;
+		// pulses fired while the previous frame was still being produced are lost, as on an overtriggered camera
+		_emit(pulse, pulse - seen - 1, exposure);
+		seen = pulse;
 	}
 }
 
@@ -95,34 +465,161 @@ std::vector<std::unique_ptr<fake>> fake::find(
 	const std::filesystem::path& base,
 	std::vector<std::string> serials,
 	bool colour,
-	const std::chrono::milliseconds& interval
+	const std::chrono::nanoseconds& interval,
+	loading mode,
+	const std::filesystem::path& cache_directory
 )
 {
 	std::vector<std::unique_ptr<fake>> ret;
 	ret.reserve(serials.size());
 	for (auto& serial : serials)
 		if (std::filesystem::exists(base / serial))
-			ret.emplace_back(new fake(base, std::move(serial), colour, interval));
+			ret.emplace_back(new fake(base, std::move(serial), colour, interval, mode, cache_directory));
 	return ret;
 }
 
 fake::~fake() noexcept
 {
+	if (_loading.valid())
+		_loading.wait();
 	stop();
 }
 
+[[nodiscard]]
+const thread_affinity& fake::acquisition_thread() const
+{
+	return _binder.affinity();
+}
+
+void fake::acquisition_thread(thread_affinity affinity)
+{
+	_binder.affinity(std::move(affinity));
+}
+
+[[nodiscard]]
+parameter_report fake::apply(const parameter_set& parameters)
+{
+	const bool restart = _simulation.joinable();
+	if (restart)
+		stop();
+	auto ret = _utils::apply_parameters(
+		parameters,
+		[this](const std::string& name, parameter_value& value, std::error_code& ec)
+		{
+			const auto node = _node(name);
+			if (!node || !std::holds_alternative<int64_t>(value))
+				ec = std::make_error_code(std::errc::invalid_argument);
+			else
+			{
+				value = int64_t(*node);
+				ec.clear();
+			}
+		},
+		[this](const std::string& name, const parameter_value& value, std::error_code& ec)
+		{
+			const auto node = _node(name);
+			const auto target = std::get_if<int64_t>(&value);
+			// factors are positive, a zero sized window covering the whole sensor
+			const int64_t minimum = name.starts_with("Binning") || name.starts_with("Decimation") ? 1 : 0;
+			if (!node || !target || *target < minimum || *target > std::numeric_limits<int>::max())
+				ec = std::make_error_code(std::errc::invalid_argument);
+			else
+			{
+				*node = int(*target);
+				ec.clear();
+			}
+		}
+	);
+	if (restart)
+		start();
+	return ret;
+}
+
+[[nodiscard]]
+size_t fake::dropped_frames() const
+{
+	return _images.dropped();
+}
+
+void fake::listener(ring_listener *listener)
+{
+	_images.listener(listener);
+}
+
 [[nodiscard]]
 base::frame fake::next_image(std::error_code& ec)
 {
-	auto guard = std::lock_guard { _lock };
-	if (_images.empty())
+	ec = _binder.error();
+	if (ec)
+		return {};
+
+	base::frame ret;
+	if (!_images.pop(ret))
+		return {};
+
+	ret.id = ++_counter;
+	_statistics.record_delivery(ret.host_timestamp);
+	return ret;
+}
+
+[[nodiscard]]
+base::frame fake::next_image(
+	std::error_code& ec,
+	std::stop_token token,
+	const std::chrono::nanoseconds& timeout
+)
+{
+	ec = _binder.error();
+	if (ec)
+		return {};
+
+	base::frame ret;
+	if (!_images.pop(ret, std::move(token), timeout))
 		return {};
 
-	base::frame ret { ++_counter, std::move(_images.front()) };
-	_images.pop_front();
+	ret.id = ++_counter;
+	_statistics.record_delivery(ret.host_timestamp);
 	return ret;
 }
 
+[[nodiscard]]
+frame_pool& fake::pool()
+{
+	return _buffers;
+}
+
+[[nodiscard]]
+size_t fake::pyramid() const
+{
+	return _pyramid.levels();
+}
+
+void fake::pyramid(size_t levels)
+{
+	_pyramid.levels(levels);
+}
+
+void fake::queue(size_t capacity, overflow_policy policy)
+{
+	_images.reset(capacity, policy);
+}
+
+[[nodiscard]]
+bool fake::raw() const
+{
+	return _raw;
+}
+
+void fake::raw(bool enable)
+{
+	_raw = enable;
+}
+
+void fake::reset_statistics()
+{
+	_statistics.reset(_images.dropped());
+}
+
 [[nodiscard]]
 base::rotation_direction fake::rotation() const
 {
@@ -142,22 +639,136 @@ std::string fake::serial() const
 
 void fake::start()
 {
+	_wait_loaded();
 	_stop = {};
 	_simulation = std::thread { &fake::_simulate, this, _stop.get_token() };
 }
 
+[[nodiscard]]
+device_statistics::snapshot fake::statistics() const
+{
+	return _statistics.take(_images.size(), _images.dropped());
+}
+
 void fake::stop()
 {
 	_stop.request_stop();
+	// a blocked simulation would otherwise never observe the stop request
+	if (_images.policy() == overflow_policy::BLOCK)
+		_images.clear();
 	if (_simulation.joinable())
 		_simulation.join();
 }
 
 void fake::subscribe()
 {
-	auto guard = std::lock_guard { _lock };
+	_wait_loaded();
 	_images.clear();
 	_counter = 0;
+
+	// shared rotated copies spare the simulation any per-frame work
+	_rotated.clear();
+	_rotated_direction = _rotation;
+	if (_zero_copy && !_raw && _rotation != base::rotation_direction::ORIGINAL)
+	{
+		_rotated.resize(_pool.size());
+		for (size_t i = 0; i < _pool.size(); ++i)
+			_utils::rotate(_pool[i], _rotated[i], _rotation);
+	}
+	else if (!_pool.empty())
+	{
+		const auto& sample = _pool.front();
+		_buffers.reserve(
+			_images.capacity(),
+			sample.rows,
+			sample.cols,
+			_raw && sample.channels() == 3 ? CV_8UC1 : sample.type()
+		);
+	}
+}
+
+[[nodiscard]]
+bool fake::zero_copy() const
+{
+	return _zero_copy;
+}
+
+void fake::zero_copy(bool enable)
+{
+	_zero_copy = enable;
+}
+
+[[nodiscard]]
+bool fake::set_manual_trigger_line_source(size_t line, const std::chrono::duration<double, std::micro>& delay)
+{
+	if (line >= _trigger_lines.size())
+		return false;
+	_trigger_line = line;
+	_trigger_delay = delay;
+	return true;
+}
+
+void fake::trigger(size_t line)
+{
+	if (line >= _trigger_lines.size())
+		throw std::out_of_range("no such trigger line");
+
+	auto& target = _trigger_lines[line];
+	{
+		auto guard = std::lock_guard { target.lock };
+		++target.pulses;
+		target.time = std::chrono::steady_clock::now();
+	}
+	target.signal.notify_all();
+}
+
+[[nodiscard]]
+std::chrono::nanoseconds fake::interval() const
+{
+	return _interval;
+}
+
+void fake::interval(const std::chrono::nanoseconds& interval)
+{
+	_interval = interval;
+}
+
+void fake::jitter(const std::chrono::nanoseconds& amplitude, uint64_t seed)
+{
+	_jitter = amplitude;
+	_seed = seed;
+}
+
+[[nodiscard]]
+bool fake::roi(cv::Rect& roi)
+{
+	roi = _roi;
+	return true;
+}
+
+[[nodiscard]]
+bool fake::set_binning(size_t horizontal, size_t vertical)
+{
+	if (!horizontal || !vertical)
+		return false;
+	_binning = { int(horizontal), int(vertical) };
+	return true;
+}
+
+[[nodiscard]]
+bool fake::set_decimation(size_t horizontal, size_t vertical)
+{
+	if (!horizontal || !vertical)
+		return false;
+	_decimation = { int(horizontal), int(vertical) };
+	return true;
+}
+
+[[nodiscard]]
+bool fake::set_roi(const cv::Rect& roi)
+{
+	_roi = roi;
+	return true;
 }
 
 }
@@ -0,0 +1,273 @@
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <stop_token>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "utilities/camera/base.hpp"
+#include "utilities/camera/group.hpp"
+
+using std::chrono_literals::operator""ms;
+
+namespace utilities::camera
+{
+
+namespace
+{
+
+// bounds the delay before a stale set is noticed while no frame arrives
+static constexpr std::chrono::nanoseconds _poll_interval = 10ms;
+
+[[nodiscard]]
+static inline uint64_t _distance(uint64_t a, uint64_t b) noexcept
+{
+	return a > b ? a - b : b - a;
+}
+
+}
+
+void group::_join()
+{
+	_stop.request_stop();
+	// a puller blocked on a full queue would otherwise never observe the stop request
+	if (_sets.policy() == overflow_policy::BLOCK)
+		_sets.clear();
+	for (auto& puller : _pullers)
+		if (puller.joinable())
+			puller.join();
+	_pullers.clear();
+}
+
+[[nodiscard]]
+uint64_t group::_key(const base::frame& frame) const noexcept
+{
+	switch (_alignment)
+	{
+		case alignment::FRAME_ID:
+			return frame.id;
+		case alignment::BLOCK_ID:
+			return frame.block_id;
+		case alignment::DEVICE_TIMESTAMP:
+			return frame.device_timestamp;
+		case alignment::HOST_TIMESTAMP:
+		default:
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				frame.host_timestamp.time_since_epoch()
+			).count();
+	}
+}
+
+void group::_expire(std::chrono::steady_clock::time_point now)
+{
+	// sets are opened in order, so the stale ones are at the front
+	while (!_pending.empty() && now - _pending.front().opened >= _timeout)
+	{
+		_resolve(_pending.front());
+		_pending.pop_front();
+	}
+}
+
+void group::_match(size_t index, base::frame frame)
+{
+	const auto key = _key(frame);
+	auto target = std::find_if(
+		_pending.begin(),
+		_pending.end(),
+		[&](const pending& set) { return !set.frames[index] && _distance(set.reference, key) <= _tolerance; }
+	);
+	if (target == _pending.end())
+	{
+		_pending.push_back({ key, std::chrono::steady_clock::now(), std::vector<base::frame>(_devices.size()), 0 });
+		target = std::prev(_pending.end());
+	}
+
+	target->frames[index] = std::move(frame);
+	if (++target->count < _devices.size())
+		return;
+
+	// every device delivers in order, so older sets still missing frames can no longer complete
+	const auto older = std::distance(_pending.begin(), target);
+	for (ptrdiff_t i = 0; i <= older; ++i)
+	{
+		_resolve(_pending.front());
+		_pending.pop_front();
+	}
+}
+
+void group::_pull(size_t index, std::stop_token token)
+{
+	auto& device = *_devices[index];
+	const auto poll = std::min(_timeout, _poll_interval);
+	while (!token.stop_requested())
+	{
+		std::error_code ec;
+		auto frame = device.next_image(ec, token, poll);
+		if (ec)
+		{
+			auto guard = std::lock_guard { _error_lock };
+			_error = ec;
+		}
+
+		auto guard = std::lock_guard { _lock };
+		if (frame)
+			_match(index, std::move(frame));
+		_expire(std::chrono::steady_clock::now());
+	}
+}
+
+void group::_resolve(pending& set)
+{
+	if (set.count < _devices.size())
+	{
+		++_incomplete;
+		if (_policy == incomplete_policy::DROP)
+		{
+			++_dropped;
+			return;
+		}
+	}
+
+	frame_set ret;
+	ret.id = ++_counter;
+	ret.frames = std::move(set.frames);
+	_sets.push(std::move(ret));
+}
+
+group::group(
+	std::vector<std::unique_ptr<base::device>> devices,
+	alignment alignment,
+	uint64_t tolerance,
+	const std::chrono::nanoseconds& timeout,
+	incomplete_policy policy
+) :
+	_devices { std::move(devices) },
+	_alignment(alignment),
+	_tolerance(tolerance),
+	_timeout(timeout),
+	_policy(policy),
+	_lock {},
+	_pending {},
+	_sets {},
+	_counter(0),
+	_incomplete(0),
+	_dropped(0),
+	_error_lock {},
+	_error {},
+	_stop {},
+	_pullers {}
+{
+	if (_devices.empty())
+		throw std::invalid_argument("empty device group");
+	for (const auto& device : _devices)
+		if (!device)
+			throw std::invalid_argument("null device in group");
+}
+
+group::~group() noexcept
+{
+	_join();
+}
+
+[[nodiscard]]
+base::device& group::operator[](size_t index)
+{
+	return *_devices.at(index);
+}
+
+[[nodiscard]]
+size_t group::dropped_sets() const
+{
+	return _dropped.load(std::memory_order_relaxed) + _sets.dropped();
+}
+
+[[nodiscard]]
+size_t group::incomplete_sets() const
+{
+	return _incomplete.load(std::memory_order_relaxed);
+}
+
+[[nodiscard]]
+group::frame_set group::next_set(std::error_code& ec, std::stop_token token, const std::chrono::nanoseconds& timeout)
+{
+	{
+		auto guard = std::lock_guard { _error_lock };
+		ec = std::exchange(_error, {});
+	}
+	if (ec)
+		return {};
+
+	frame_set ret;
+	if (!_sets.pop(ret, std::move(token), timeout))
+		return {};
+	return ret;
+}
+
+[[nodiscard]]
+group::frame_set group::next_set(std::stop_token token, const std::chrono::nanoseconds& timeout)
+{
+	std::error_code ec;
+	auto ret = next_set(ec, std::move(token), timeout);
+	if (ec)
+		throw std::system_error(ec);
+	return ret;
+}
+
+void group::queue(size_t capacity, overflow_policy policy)
+{
+	_sets.reset(capacity, policy);
+}
+
+[[nodiscard]]
+size_t group::size() const noexcept
+{
+	return _devices.size();
+}
+
+void group::start()
+{
+	{
+		auto guard = std::lock_guard { _lock };
+		_pending.clear();
+		_sets.clear();
+		_counter = 0;
+		_incomplete = 0;
+		_dropped = 0;
+	}
+	{
+		auto guard = std::lock_guard { _error_lock };
+		_error.clear();
+	}
+
+	for (auto& device : _devices)
+	{
+		device->subscribe();
+		device->start();
+	}
+
+	_stop = {};
+	_pullers.reserve(_devices.size());
+	for (size_t i = 0; i < _devices.size(); ++i)
+		_pullers.emplace_back(&group::_pull, this, i, _stop.get_token());
+}
+
+void group::stop()
+{
+	_join();
+	for (auto& device : _devices)
+	{
+		device->stop();
+		device->unsubscribe();
+	}
+}
+
+}
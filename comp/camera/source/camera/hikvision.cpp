@@ -1,11 +1,16 @@
 #include <cstddef>
+#include <cstdint>
 
-#include <mutex>
+#include <array>
+#include <chrono>
+#include <optional>
+#include <stop_token>
 #include <string>
 #include <system_error>
 #include <type_traits>
 #include <unordered_map>
 #include <utility>
+#include <variant>
 
 #include <MvCameraControl.h>
 
@@ -61,24 +66,65 @@ inline void _wrap_mvs(F&& f, Args&&... args)
 
 }
 
+void hikvision::_exception(unsigned int type, void *user)
+{
+	if (type == MV_EXCEPTION_DEV_DISCONNECT)
+		reinterpret_cast<hikvision *>(user)->_disconnected = true;
+}
+
 void hikvision::_callback(unsigned char *data, ::MV_FRAME_OUT_INFO_EX *info, void *user)
 {
+	const auto received = std::chrono::steady_clock::now();
 	auto self = reinterpret_cast<hikvision *>(user);
+	self->_binder.bind();
+	const auto push = [&](base::frame frame)
+	{
+		frame.block_id = info->nFrameNum;
+		frame.device_timestamp = (uint64_t(info->nDevTimeStampHigh) << 32) | info->nDevTimeStampLow;
+		frame.host_timestamp = received;
+		frame.gap = _utils::gap(self->_last_block_id, frame.block_id);
+		self->_pyramid.build(frame);
+		const auto converted = std::chrono::steady_clock::now();
+		const auto gap = frame.gap;
+		self->_images.push(std::move(frame));
+		self->_statistics.record_callback(received, converted, gap);
+	};
+
+	// raw frames are only copied out of the SDK buffer, leaving conversion and rotation to the consumer
+	if (self->_raw)
+		if (const auto format = _utils::gvsp_pixel_format(info->enPixelType))
+			if (auto output = _utils::copy_raw(
+				self->_buffers,
+				data,
+				info->nFrameLen,
+				info->nHeight,
+				info->nWidth,
+				*format
+			); !output.empty())
+			{
+				push({ 0, std::move(output), *format });
+				return;
+			}
+
 	const auto required_pixel_type = self->_colour ?
 		::MvGvspPixelType::PixelType_Gvsp_BGR8_Packed :
 		::MvGvspPixelType::PixelType_Gvsp_Mono8;
+	const auto type = self->_colour ? CV_8UC3 : CV_8UC1;
+	const auto rotation = self->_rotation;
 
-	cv::Mat image;
+	// the SDK reuses its buffer after returning, so the single unavoidable copy goes straight into the frame
+	cv::Mat output;
 	if (info->enPixelType == required_pixel_type)
-		cv::Mat(
-			info->nHeight,
-			info->nWidth,
-			self->_colour ? CV_8UC3 : CV_8UC1,
-			data
-		).copyTo(image);
+		output = _utils::rotate(cv::Mat(info->nHeight, info->nWidth, type, data), self->_buffers, rotation);
 	else
 	{
-		image.create(info->nHeight, info->nWidth, self->_colour ? CV_8UC3 : CV_8UC1);
+		// convert in place unless a rotation still has to follow
+		const bool direct = rotation == base::rotation_direction::ORIGINAL;
+		auto& image = direct ? output : self->_converted;
+		if (direct)
+			self->_buffers.acquire(image, info->nHeight, info->nWidth, type);
+		else
+			image.create(info->nHeight, info->nWidth, type);
 
 		::MV_CC_PIXEL_CONVERT_PARAM param {};
 		param.nWidth = info->nWidth;
@@ -91,20 +137,51 @@ void hikvision::_callback(unsigned char *data, ::MV_FRAME_OUT_INFO_EX *info, voi
 		param.nDstBufferSize = param.nDstLen = info->nHeight * info->nWidth * image.channels();
 
 		_wrap_mvs(::MV_CC_ConvertPixelType, self->_handle, &param);
+
+		if (!direct)
+			output = _utils::rotate(image, self->_buffers, rotation);
+	}
+
+	push({ 0, std::move(output) });
+}
+
+namespace
+{
+
+[[nodiscard]]
+std::string _serial_number(const ::MV_CC_DEVICE_INFO& device_info)
+{
+	switch (device_info.nTLayerType)
+	{
+		case MV_GIGE_DEVICE:
+			return reinterpret_cast<const char *>(device_info.SpecialInfo.stGigEInfo.chSerialNumber);
+		case MV_USB_DEVICE:
+			return reinterpret_cast<const char *>(device_info.SpecialInfo.stUsb3VInfo.chSerialNumber);
+		default:
+			throw std::logic_error("unexpected device transport layer type");
 	}
+}
 
-	auto guard = std::lock_guard { self->_lock };
-	_utils::rotate(image, self->_images.emplace_back(), self->_rotation);
 }
 
 hikvision::hikvision(const ::MV_CC_DEVICE_INFO *device_info, bool colour) :
 	device {},
 	_handle(nullptr),
+	_serial(_serial_number(*device_info)),
+	_layer(device_info->nTLayerType),
 	_colour(colour),
+	_raw(false),
 	_rotation(base::rotation_direction::ORIGINAL),
-	_lock {},
+	_converted {},
+	_buffers {},
 	_images {},
-	_counter(0)
+	_counter(0),
+	_last_block_id {},
+	_statistics {},
+	_binder {},
+	_pyramid {},
+	_grabbing(false),
+	_disconnected(false)
 {
 	_wrap_mvs(::MV_CC_CreateHandleWithoutLog, &_handle, device_info);
 }
@@ -194,26 +271,246 @@ hikvision::~hikvision() noexcept
 	_handle = nullptr;
 }
 
+[[nodiscard]]
+const thread_affinity& hikvision::acquisition_thread() const
+{
+	return _binder.affinity();
+}
+
+void hikvision::acquisition_thread(thread_affinity affinity)
+{
+	_binder.affinity(std::move(affinity));
+}
+
+namespace
+{
+
+static inline void _mvs_read(void *handle, const char *name, parameter_value& value, std::error_code& ec)
+{
+	std::visit([&](auto& current)
+	{
+		using T = std::decay_t<decltype(current)>;
+		if constexpr (std::is_same_v<T, bool>)
+			_wrap_mvs(ec, ::MV_CC_GetBoolValue, handle, name, &current);
+		else if constexpr (std::is_same_v<T, int64_t>)
+		{
+			::MVCC_INTVALUE_EX node {};
+			_wrap_mvs(ec, ::MV_CC_GetIntValueEx, handle, name, &node);
+			current = node.nCurValue;
+		}
+		else if constexpr (std::is_same_v<T, double>)
+		{
+			::MVCC_FLOATVALUE node {};
+			_wrap_mvs(ec, ::MV_CC_GetFloatValue, handle, name, &node);
+			current = node.fCurValue;
+		}
+		else if constexpr (std::is_same_v<T, enumeration>)
+		{
+			::MVCC_ENUMVALUE node {};
+			_wrap_mvs(ec, ::MV_CC_GetEnumValue, handle, name, &node);
+			::MVCC_ENUMENTRY entry {};
+			entry.nValue = node.nCurValue;
+			if (!ec)
+				_wrap_mvs(ec, ::MV_CC_GetEnumEntrySymbolic, handle, name, &entry);
+			current.symbol = entry.chSymbolic;
+		}
+		else
+		{
+			::MVCC_STRINGVALUE node {};
+			_wrap_mvs(ec, ::MV_CC_GetStringValue, handle, name, &node);
+			current = node.chCurValue;
+		}
+	}, value);
+}
+
+static inline void _mvs_write(void *handle, const char *name, const parameter_value& value, std::error_code& ec)
+{
+	std::visit([&](const auto& target)
+	{
+		using T = std::decay_t<decltype(target)>;
+		if constexpr (std::is_same_v<T, bool>)
+			_wrap_mvs(ec, ::MV_CC_SetBoolValue, handle, name, target);
+		else if constexpr (std::is_same_v<T, int64_t>)
+			_wrap_mvs(ec, ::MV_CC_SetIntValueEx, handle, name, target);
+		else if constexpr (std::is_same_v<T, double>)
+			_wrap_mvs(ec, ::MV_CC_SetFloatValue, handle, name, float(target));
+		else if constexpr (std::is_same_v<T, enumeration>)
+			_wrap_mvs(ec, ::MV_CC_SetEnumValueByString, handle, name, target.symbol.c_str());
+		else
+			_wrap_mvs(ec, ::MV_CC_SetStringValue, handle, name, target.c_str());
+	}, value);
+}
+
+}
+
+void hikvision::_reserve()
+{
+	::MVCC_INTVALUE_EX width {}, height {};
+	std::error_code ec;
+	_wrap_mvs(ec, ::MV_CC_GetIntValueEx, _handle, "Width", &width);
+	if (!ec)
+		_wrap_mvs(ec, ::MV_CC_GetIntValueEx, _handle, "Height", &height);
+	if (!ec && _raw)
+	{
+		::MVCC_ENUMVALUE pixel_format {};
+		_wrap_mvs(ec, ::MV_CC_GetEnumValue, _handle, "PixelFormat", &pixel_format);
+		if (!ec)
+			_utils::reserve_raw(
+				_buffers,
+				_images.capacity(),
+				int(height.nCurValue),
+				int(width.nCurValue),
+				pixel_format.nCurValue
+			);
+	}
+	else if (!ec)
+		_buffers.reserve(_images.capacity(), height.nCurValue, width.nCurValue, _colour ? CV_8UC3 : CV_8UC1);
+}
+
+[[nodiscard]]
+parameter_report hikvision::apply(const parameter_set& parameters)
+{
+	const bool restart = _grabbing;
+	if (restart)
+		stop();
+	auto ret = _utils::apply_parameters(
+		parameters,
+		[this](const std::string& name, parameter_value& value, std::error_code& ec)
+		{
+			_mvs_read(_handle, name.c_str(), value, ec);
+		},
+		[this](const std::string& name, const parameter_value& value, std::error_code& ec)
+		{
+			_mvs_write(_handle, name.c_str(), value, ec);
+		}
+	);
+	if (restart)
+		start();
+	return ret;
+}
+
 void hikvision::close()
 {
 	_wrap_mvs(::MV_CC_CloseDevice, _handle);
 }
 
+[[nodiscard]]
+bool hikvision::disconnected() const
+{
+	return _disconnected;
+}
+
+[[nodiscard]]
+size_t hikvision::dropped_frames() const
+{
+	return _images.dropped();
+}
+
+void hikvision::listener(ring_listener *listener)
+{
+	_images.listener(listener);
+}
+
 [[nodiscard]]
 base::frame hikvision::next_image(std::error_code& ec)
 {
-	auto guard = std::lock_guard { _lock };
-	if (_images.empty())
+	ec = _binder.error();
+	if (ec)
+		return {};
+
+	base::frame ret;
+	if (!_images.pop(ret))
 		return {};
 
-	base::frame ret { ++_counter, std::move(_images.front()) };
-	_images.pop_front();
+	ret.id = ++_counter;
+	_statistics.record_delivery(ret.host_timestamp);
+	return ret;
+}
+
+[[nodiscard]]
+base::frame hikvision::next_image(
+	std::error_code& ec,
+	std::stop_token token,
+	const std::chrono::nanoseconds& timeout
+)
+{
+	ec = _binder.error();
+	if (ec)
+		return {};
+
+	base::frame ret;
+	if (!_images.pop(ret, std::move(token), timeout))
+		return {};
+
+	ret.id = ++_counter;
+	_statistics.record_delivery(ret.host_timestamp);
 	return ret;
 }
 
 void hikvision::open()
 {
 	_wrap_mvs(::MV_CC_OpenDevice, _handle, MV_ACCESS_Control, 0);
+	_wrap_mvs(::MV_CC_RegisterExceptionCallBack, _handle, _exception, this);
+	_disconnected = false;
+}
+
+[[nodiscard]]
+frame_pool& hikvision::pool()
+{
+	return _buffers;
+}
+
+[[nodiscard]]
+size_t hikvision::pyramid() const
+{
+	return _pyramid.levels();
+}
+
+void hikvision::pyramid(size_t levels)
+{
+	_pyramid.levels(levels);
+}
+
+void hikvision::queue(size_t capacity, overflow_policy policy)
+{
+	_images.reset(capacity, policy);
+}
+
+[[nodiscard]]
+bool hikvision::raw() const
+{
+	return _raw;
+}
+
+void hikvision::raw(bool enable)
+{
+	_raw = enable;
+}
+
+void hikvision::reconnect()
+{
+	// the handle of a lost device stays stale, a new one is created from a fresh enumeration
+	std::error_code ec;
+	_wrap_mvs(ec, ::MV_CC_CloseDevice, _handle);
+	_grabbing = false;
+
+	::MV_CC_DEVICE_INFO_LIST list {};
+	_wrap_mvs(::MV_CC_EnumDevices, _layer, &list);
+	for (size_t i = 0; i < list.nDeviceNum; ++i)
+		if (_serial_number(*list.pDeviceInfo[i]) == _serial)
+		{
+			_wrap_mvs(ec, ::MV_CC_DestroyHandle, _handle);
+			_handle = nullptr;
+			_wrap_mvs(::MV_CC_CreateHandleWithoutLog, &_handle, list.pDeviceInfo[i]);
+			open();
+			return;
+		}
+	throw std::system_error(std::make_error_code(std::errc::no_such_device), _serial);
+}
+
+void hikvision::reset_statistics()
+{
+	_statistics.reset(_images.dropped());
 }
 
 [[nodiscard]]
@@ -230,36 +527,42 @@ void hikvision::rotation(base::rotation_direction rotation)
 [[nodiscard]]
 std::string hikvision::serial() const
 {
-	::MV_CC_DEVICE_INFO device_info {};
-	_wrap_mvs(::MV_CC_GetDeviceInfo, _handle, &device_info);
-	switch (device_info.nTLayerType)
-	{
-		case MV_GIGE_DEVICE:
-			return reinterpret_cast<char *>(device_info.SpecialInfo.stGigEInfo.chSerialNumber);
-		case MV_USB_DEVICE:
-			return reinterpret_cast<char *>(device_info.SpecialInfo.stUsb3VInfo.chSerialNumber);
-		default:
-			throw std::logic_error("unexpected device transport layer type");
-	}
+	return _serial;
 }
 
 void hikvision::start()
 {
+	_reserve();
 	_wrap_mvs(::MV_CC_StartGrabbing, _handle);
+	_grabbing = true;
+}
+
+[[nodiscard]]
+device_statistics::snapshot hikvision::statistics() const
+{
+	return _statistics.take(_images.size(), _images.dropped());
 }
 
 void hikvision::stop()
 {
-	_wrap_mvs(::MV_CC_StopGrabbing, _handle);
+	// a callback blocked on a full queue would otherwise keep the grab from stopping
+	_images.stopping(true);
+	std::error_code ec;
+	_wrap_mvs(ec, ::MV_CC_StopGrabbing, _handle);
+	// no callback runs anymore once the grab has stopped
+	_images.stopping(false);
+	if (ec)
+		throw std::system_error(ec);
+	_grabbing = false;
 }
 
 void hikvision::subscribe()
 {
 	_wrap_mvs(::MV_CC_RegisterImageCallBackEx, _handle, _callback, this);
 
-	auto guard = std::lock_guard { _lock };
 	_images.clear();
 	_counter = 0;
+	_last_block_id.reset();
 }
 
 void hikvision::unsubscribe()
@@ -379,6 +682,7 @@ bool hikvision::output_signal(size_t line, const std::chrono::microseconds& dura
 [[nodiscard]]
 bool hikvision::set_manual_trigger_line_source(size_t line, const std::chrono::duration<double, std::micro>& delay)
 {
+	// written live rather than through apply, which would restart the grab and drop the queued frames
 	return line < _universal_lines.size() &&
 		_mvs_set<false>(_handle, "TriggerSource", _universal_lines[line]) &&
 		_mvs_set<false>(_handle, "TriggerActivation", "RisingEdge") &&
@@ -386,4 +690,63 @@ bool hikvision::set_manual_trigger_line_source(size_t line, const std::chrono::d
 		_mvs_set<false>(_handle, "TriggerMode", "On");
 }
 
+namespace
+{
+
+[[nodiscard]]
+inline bool _mvs_get(void *handle, const char *name, _utils::integer_node& node)
+{
+	::MVCC_INTVALUE_EX value {};
+	std::error_code ec;
+	_wrap_mvs(ec, ::MV_CC_GetIntValueEx, handle, name, &value);
+	node = { value.nCurValue, value.nMin, value.nMax, value.nInc };
+	return !ec;
+}
+
+// enumerations valued after their factor on most models, integers on the others
+[[nodiscard]]
+inline bool _mvs_set_factor(void *handle, const char *name, size_t factor)
+{
+	std::error_code ec;
+	_wrap_mvs(ec, ::MV_CC_SetEnumValue, handle, name, static_cast<unsigned int>(factor));
+	return !ec || _mvs_set(handle, name, int64_t(factor));
+}
+
+}
+
+[[nodiscard]]
+bool hikvision::roi(cv::Rect& roi)
+{
+	return _utils::read_roi(roi, [this](const char *name, _utils::integer_node& node)
+	{
+		return _mvs_get(_handle, name, node);
+	});
+}
+
+[[nodiscard]]
+bool hikvision::set_binning(size_t horizontal, size_t vertical)
+{
+	return horizontal && vertical &&
+		_mvs_set_factor(_handle, "BinningHorizontal", horizontal) &&
+		_mvs_set_factor(_handle, "BinningVertical", vertical);
+}
+
+[[nodiscard]]
+bool hikvision::set_decimation(size_t horizontal, size_t vertical)
+{
+	return horizontal && vertical &&
+		_mvs_set_factor(_handle, "DecimationHorizontal", horizontal) &&
+		_mvs_set_factor(_handle, "DecimationVertical", vertical);
+}
+
+[[nodiscard]]
+bool hikvision::set_roi(const cv::Rect& roi)
+{
+	return _utils::apply_roi(
+		roi,
+		[this](const char *name, _utils::integer_node& node) { return _mvs_get(_handle, name, node); },
+		[this](const char *name, int64_t value) { return _mvs_set(_handle, name, value); }
+	);
+}
+
 }
@@ -1,7 +1,16 @@
 #include <cstddef>
+#include <cstdint>
 
+#include <chrono>
 #include <memory>
+#include <optional>
+#include <stop_token>
+#include <string>
 #include <system_error>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
 #include <vector>
 
 #include <IMVApi.h>
@@ -55,24 +64,67 @@ inline void _wrap_mv(F&& f, Args&&... args)
 
 }
 
+void huaray::_connection(const ::IMV_SConnectArg *argument, void *user)
+{
+	// coming back online is not enough, the device has to be opened again
+	if (argument->event == ::IMV_EVType::offLine)
+		reinterpret_cast<huaray *>(user)->_disconnected = true;
+}
+
 void huaray::_callback(::IMV_Frame *frame, void *user)
 {
+	const auto received = std::chrono::steady_clock::now();
 	auto self = reinterpret_cast<huaray *>(user);
+	self->_binder.bind();
+	const auto& info = frame->frameInfo;
+	const auto push = [&](base::frame result)
+	{
+		result.block_id = info.blockId;
+		result.device_timestamp = info.timeStamp;
+		result.host_timestamp = received;
+		result.gap = _utils::gap(self->_last_block_id, result.block_id);
+		self->_pyramid.build(result);
+		const auto converted = std::chrono::steady_clock::now();
+		const auto gap = result.gap;
+		self->_images.push(std::move(result));
+		self->_statistics.record_callback(received, converted, gap);
+	};
+
+	// raw frames are only copied out of the SDK buffer, leaving conversion and rotation to the consumer
+	if (self->_raw)
+		if (const auto format = _utils::gvsp_pixel_format(info.pixelFormat))
+			if (auto output = _utils::copy_raw(
+				self->_buffers,
+				frame->pData,
+				info.size,
+				info.height,
+				info.width,
+				*format
+			); !output.empty())
+			{
+				push({ 0, std::move(output), *format });
+				return;
+			}
+
 	const auto required_pixel_type = self->_colour ?
 		::IMV_EPixelType::gvspPixelBGR8 :
 		::IMV_EPixelType::gvspPixelMono8;
+	const auto type = self->_colour ? CV_8UC3 : CV_8UC1;
+	const auto rotation = self->_rotation;
 
-	cv::Mat image;
-	if (const auto& info = frame->frameInfo; info.pixelFormat == required_pixel_type)
-		cv::Mat(
-			info.height,
-			info.width,
-			self->_colour ? CV_8UC3 : CV_8UC1,
-			frame->pData
-		).copyTo(image);
+	// the SDK reuses its buffer after returning, so the single unavoidable copy goes straight into the frame
+	cv::Mat output;
+	if (info.pixelFormat == required_pixel_type)
+		output = _utils::rotate(cv::Mat(info.height, info.width, type, frame->pData), self->_buffers, rotation);
 	else
 	{
-		image.create(info.height, info.width, self->_colour ? CV_8UC3 : CV_8UC1);
+		// convert in place unless a rotation still has to follow
+		const bool direct = rotation == base::rotation_direction::ORIGINAL;
+		auto& image = direct ? output : self->_converted;
+		if (direct)
+			self->_buffers.acquire(image, info.height, info.width, type);
+		else
+			image.create(info.height, info.width, type);
 
 		::IMV_PixelConvertParam param {};
 		param.nWidth = info.width;
@@ -85,20 +137,29 @@ void huaray::_callback(::IMV_Frame *frame, void *user)
 		param.nDstBufSize = param.nDstDataLen = info.height * info.width * image.channels();
 
 		_wrap_mv(::IMV_PixelConvert, self->_handle, &param);
+
+		if (!direct)
+			output = _utils::rotate(image, self->_buffers, rotation);
 	}
 
-	auto guard = std::lock_guard { self->_lock };
-	_utils::rotate(image, self->_images.emplace_back(), self->_rotation);
+	push({ 0, std::move(output) });
 }
 
 huaray::huaray(unsigned int index, bool colour) :
 	device {},
 	_handle(nullptr),
 	_colour(colour),
+	_raw(false),
 	_rotation(base::rotation_direction::ORIGINAL),
-	_lock {},
+	_converted {},
+	_buffers {},
 	_images {},
-	_counter(0)
+	_counter(0),
+	_last_block_id {},
+	_statistics {},
+	_binder {},
+	_pyramid {},
+	_disconnected(false)
 {
 	_wrap_mv(::IMV_CreateHandle, &_handle, ::IMV_ECreateHandleMode::modeByIndex, reinterpret_cast<void *>(index));
 }
@@ -149,14 +210,217 @@ huaray::~huaray() noexcept
 	_handle = nullptr;
 }
 
+[[nodiscard]]
+const thread_affinity& huaray::acquisition_thread() const
+{
+	return _binder.affinity();
+}
+
+void huaray::acquisition_thread(thread_affinity affinity)
+{
+	_binder.affinity(std::move(affinity));
+}
+
+namespace
+{
+
+static inline void _mv_read(::IMV_HANDLE handle, const char *name, parameter_value& value, std::error_code& ec)
+{
+	std::visit([&](auto& current)
+	{
+		using T = std::decay_t<decltype(current)>;
+		if constexpr (std::is_same_v<T, bool>)
+			_wrap_mv(ec, ::IMV_GetBoolFeatureValue, handle, name, &current);
+		else if constexpr (std::is_same_v<T, int64_t>)
+			_wrap_mv(ec, ::IMV_GetIntFeatureValue, handle, name, &current);
+		else if constexpr (std::is_same_v<T, double>)
+			_wrap_mv(ec, ::IMV_GetDoubleFeatureValue, handle, name, &current);
+		else
+		{
+			::IMV_String node {};
+			if constexpr (std::is_same_v<T, enumeration>)
+			{
+				_wrap_mv(ec, ::IMV_GetEnumFeatureSymbol, handle, name, &node);
+				current.symbol = node.str;
+			}
+			else
+			{
+				_wrap_mv(ec, ::IMV_GetStringFeatureValue, handle, name, &node);
+				current = node.str;
+			}
+		}
+	}, value);
+}
+
+static inline void _mv_write(::IMV_HANDLE handle, const char *name, const parameter_value& value, std::error_code& ec)
+{
+	std::visit([&](const auto& target)
+	{
+		using T = std::decay_t<decltype(target)>;
+		if constexpr (std::is_same_v<T, bool>)
+			_wrap_mv(ec, ::IMV_SetBoolFeatureValue, handle, name, target);
+		else if constexpr (std::is_same_v<T, int64_t>)
+			_wrap_mv(ec, ::IMV_SetIntFeatureValue, handle, name, target);
+		else if constexpr (std::is_same_v<T, double>)
+			_wrap_mv(ec, ::IMV_SetDoubleFeatureValue, handle, name, target);
+		else if constexpr (std::is_same_v<T, enumeration>)
+			_wrap_mv(ec, ::IMV_SetEnumFeatureSymbol, handle, name, target.symbol.c_str());
+		else
+			_wrap_mv(ec, ::IMV_SetStringFeatureValue, handle, name, target.c_str());
+	}, value);
+}
+
+}
+
+void huaray::_reserve()
+{
+	int64_t width, height;
+	std::error_code ec;
+	_wrap_mv(ec, ::IMV_GetIntFeatureValue, _handle, "Width", &width);
+	if (!ec)
+		_wrap_mv(ec, ::IMV_GetIntFeatureValue, _handle, "Height", &height);
+	if (!ec && _raw)
+	{
+		uint64_t pixel_format;
+		_wrap_mv(ec, ::IMV_GetEnumFeatureValue, _handle, "PixelFormat", &pixel_format);
+		if (!ec)
+			_utils::reserve_raw(_buffers, _images.capacity(), int(height), int(width), uint32_t(pixel_format));
+	}
+	else if (!ec)
+		_buffers.reserve(_images.capacity(), height, width, _colour ? CV_8UC3 : CV_8UC1);
+}
+
+[[nodiscard]]
+parameter_report huaray::apply(const parameter_set& parameters)
+{
+	const bool restart = ::IMV_IsGrabbing(_handle);
+	if (restart)
+		stop();
+	auto ret = _utils::apply_parameters(
+		parameters,
+		[this](const std::string& name, parameter_value& value, std::error_code& ec)
+		{
+			_mv_read(_handle, name.c_str(), value, ec);
+		},
+		[this](const std::string& name, const parameter_value& value, std::error_code& ec)
+		{
+			_mv_write(_handle, name.c_str(), value, ec);
+		}
+	);
+	if (restart)
+		start();
+	return ret;
+}
+
 void huaray::close()
 {
 	_wrap_mv(::IMV_Close, _handle);
 }
 
+[[nodiscard]]
+bool huaray::disconnected() const
+{
+	return _disconnected;
+}
+
+[[nodiscard]]
+size_t huaray::dropped_frames() const
+{
+	return _images.dropped();
+}
+
+void huaray::listener(ring_listener *listener)
+{
+	_images.listener(listener);
+}
+
+[[nodiscard]]
+base::frame huaray::next_image(std::error_code& ec)
+{
+	ec = _binder.error();
+	if (ec)
+		return {};
+
+	base::frame ret;
+	if (!_images.pop(ret))
+		return {};
+
+	ret.id = ++_counter;
+	_statistics.record_delivery(ret.host_timestamp);
+	return ret;
+}
+
+[[nodiscard]]
+base::frame huaray::next_image(
+	std::error_code& ec,
+	std::stop_token token,
+	const std::chrono::nanoseconds& timeout
+)
+{
+	ec = _binder.error();
+	if (ec)
+		return {};
+
+	base::frame ret;
+	if (!_images.pop(ret, std::move(token), timeout))
+		return {};
+
+	ret.id = ++_counter;
+	_statistics.record_delivery(ret.host_timestamp);
+	return ret;
+}
+
 void huaray::open()
 {
 	_wrap_mv(::IMV_OpenEx, _handle, ::IMV_ECameraAccessPermission::accessPermissionControl);
+	_wrap_mv(::IMV_SubscribeConnectArg, _handle, _connection, this);
+	_disconnected = false;
+}
+
+[[nodiscard]]
+frame_pool& huaray::pool()
+{
+	return _buffers;
+}
+
+[[nodiscard]]
+size_t huaray::pyramid() const
+{
+	return _pyramid.levels();
+}
+
+void huaray::pyramid(size_t levels)
+{
+	_pyramid.levels(levels);
+}
+
+void huaray::queue(size_t capacity, overflow_policy policy)
+{
+	_images.reset(capacity, policy);
+}
+
+[[nodiscard]]
+bool huaray::raw() const
+{
+	return _raw;
+}
+
+void huaray::raw(bool enable)
+{
+	_raw = enable;
+}
+
+void huaray::reconnect()
+{
+	// the handle stays bound to the device it was created for, opening it again is enough
+	std::error_code ec;
+	_wrap_mv(ec, ::IMV_Close, _handle);
+	open();
+}
+
+void huaray::reset_statistics()
+{
+	_statistics.reset(_images.dropped());
 }
 
 [[nodiscard]]
@@ -180,21 +444,35 @@ std::string huaray::serial() const
 
 void huaray::start()
 {
+	_reserve();
 	_wrap_mv(::IMV_StartGrabbing, _handle);
 }
 
+[[nodiscard]]
+device_statistics::snapshot huaray::statistics() const
+{
+	return _statistics.take(_images.size(), _images.dropped());
+}
+
 void huaray::stop()
 {
-	_wrap_mv(::IMV_StopGrabbing, _handle);
+	// a callback blocked on a full queue would otherwise keep the grab from stopping
+	_images.stopping(true);
+	std::error_code ec;
+	_wrap_mv(ec, ::IMV_StopGrabbing, _handle);
+	// no callback runs anymore once the grab has stopped
+	_images.stopping(false);
+	if (ec)
+		throw std::system_error(ec);
 }
 
 void huaray::subscribe()
 {
 	_wrap_mv(::IMV_AttachGrabbing, _handle, &huaray::_callback, this);
 
-	auto guard = std::lock_guard { _lock };
 	_images.clear();
 	_counter = 0;
+	_last_block_id.reset();
 }
 
 void huaray::unsubscribe()
@@ -202,4 +480,77 @@ void huaray::unsubscribe()
 	_wrap_mv(::IMV_AttachGrabbing, _handle, nullptr, nullptr);
 }
 
+namespace
+{
+
+[[nodiscard]]
+inline bool _mv_get(::IMV_HANDLE handle, const char *name, _utils::integer_node& node)
+{
+	std::error_code ec;
+	_wrap_mv(ec, ::IMV_GetIntFeatureValue, handle, name, &node.value);
+	if (!ec)
+		_wrap_mv(ec, ::IMV_GetIntFeatureMin, handle, name, &node.min);
+	if (!ec)
+		_wrap_mv(ec, ::IMV_GetIntFeatureMax, handle, name, &node.max);
+	if (!ec)
+		_wrap_mv(ec, ::IMV_GetIntFeatureInc, handle, name, &node.increment);
+	return !ec;
+}
+
+[[nodiscard]]
+inline bool _mv_set(::IMV_HANDLE handle, const char *name, int64_t value)
+{
+	std::error_code ec;
+	_wrap_mv(ec, ::IMV_SetIntFeatureValue, handle, name, value);
+	return !ec;
+}
+
+// integers on most models, enumerations valued after their factor on the others
+[[nodiscard]]
+inline bool _mv_set_factor(::IMV_HANDLE handle, const char *name, size_t factor)
+{
+	if (_mv_set(handle, name, int64_t(factor)))
+		return true;
+	std::error_code ec;
+	_wrap_mv(ec, ::IMV_SetEnumFeatureValue, handle, name, uint64_t(factor));
+	return !ec;
+}
+
+}
+
+[[nodiscard]]
+bool huaray::roi(cv::Rect& roi)
+{
+	return _utils::read_roi(roi, [this](const char *name, _utils::integer_node& node)
+	{
+		return _mv_get(_handle, name, node);
+	});
+}
+
+[[nodiscard]]
+bool huaray::set_binning(size_t horizontal, size_t vertical)
+{
+	return horizontal && vertical &&
+		_mv_set_factor(_handle, "BinningHorizontal", horizontal) &&
+		_mv_set_factor(_handle, "BinningVertical", vertical);
+}
+
+[[nodiscard]]
+bool huaray::set_decimation(size_t horizontal, size_t vertical)
+{
+	return horizontal && vertical &&
+		_mv_set_factor(_handle, "DecimationHorizontal", horizontal) &&
+		_mv_set_factor(_handle, "DecimationVertical", vertical);
+}
+
+[[nodiscard]]
+bool huaray::set_roi(const cv::Rect& roi)
+{
+	return _utils::apply_roi(
+		roi,
+		[this](const char *name, _utils::integer_node& node) { return _mv_get(_handle, name, node); },
+		[this](const char *name, int64_t value) { return _mv_set(_handle, name, value); }
+	);
+}
+
 }
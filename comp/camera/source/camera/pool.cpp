@@ -0,0 +1,289 @@
+#include <cstddef>
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "utilities/camera/pool.hpp"
+
+namespace utilities::camera
+{
+
+class frame_pool::allocator final : public cv::MatAllocator
+{
+	mutable std::mutex _lock;
+	mutable std::vector<cv::uchar *> _idle;
+	size_t _capacity;
+	mutable size_t _block_size;
+	mutable size_t _owned;
+	mutable size_t _in_use;
+	mutable size_t _high_water_mark;
+	// every buffer handed out, pooled or not, keeps the allocator alive
+	mutable size_t _outstanding;
+	bool _retired;
+
+	// must be called with the lock held
+	void _retarget(size_t block_size) const
+	{
+		_shrink(0);
+		// buffers of the previous size still in use will be freed on return instead of being recycled
+		_owned = 0;
+		_in_use = 0;
+		_block_size = block_size;
+	}
+
+	// must be called with the lock held
+	void _shrink(size_t capacity) const
+	{
+		while (_idle.size() > capacity)
+		{
+			cv::fastFree(_idle.back());
+			_idle.pop_back();
+			--_owned;
+		}
+	}
+
+	[[nodiscard]]
+	cv::uchar *_take(size_t size) const
+	{
+		auto guard = std::lock_guard { _lock };
+		++_outstanding;
+		// sized lazily by the first frame unless reserved beforehand
+		if (!_block_size)
+			_block_size = size;
+		if (size == _block_size)
+		{
+			_high_water_mark = std::max(_high_water_mark, ++_in_use);
+			if (!_idle.empty())
+			{
+				auto ret = _idle.back();
+				_idle.pop_back();
+				return ret;
+			}
+			++_owned;
+		}
+		return static_cast<cv::uchar *>(cv::fastMalloc(size));
+	}
+
+	// returns true if this allocator should be destroyed
+	[[nodiscard]]
+	bool _give(cv::uchar *data, size_t size) const
+	{
+		auto guard = std::lock_guard { _lock };
+		--_outstanding;
+		if (size == _block_size)
+		{
+			--_in_use;
+			if (_idle.size() < _capacity)
+				_idle.push_back(data);
+			else
+			{
+				cv::fastFree(data);
+				--_owned;
+			}
+		}
+		else
+			cv::fastFree(data);
+		return _retired && !_outstanding;
+	}
+public:
+	allocator(size_t capacity) :
+		MatAllocator {},
+		_lock {},
+		_idle {},
+		_capacity(capacity),
+		_block_size(0),
+		_owned(0),
+		_in_use(0),
+		_high_water_mark(0),
+		_outstanding(0),
+		_retired(false)
+	{
+		_idle.reserve(capacity);
+	}
+
+	virtual ~allocator() noexcept override
+	{
+		_shrink(0);
+	}
+
+	[[nodiscard]]
+	virtual cv::UMatData *allocate(
+		int dims,
+		const int *sizes,
+		int type,
+		void *data,
+		size_t *step,
+		cv::AccessFlag flags,
+		cv::UMatUsageFlags usage_flags
+	) const override
+	{
+		size_t total = CV_ELEM_SIZE(type);
+		for (int i = dims - 1; i >= 0; --i)
+		{
+			if (step)
+			{
+				if (data && step[i] != CV_AUTOSTEP)
+					total = step[i];
+				else
+					step[i] = total;
+			}
+			total *= sizes[i];
+		}
+
+		auto ret = new cv::UMatData(this);
+		ret->size = total;
+		if (data)
+		{
+			ret->data = ret->origdata = static_cast<cv::uchar *>(data);
+			ret->flags |= cv::UMatData::USER_ALLOCATED;
+		}
+		else
+			ret->data = ret->origdata = _take(total);
+		return ret;
+	}
+
+	[[nodiscard]]
+	virtual bool allocate(cv::UMatData *data, cv::AccessFlag flags, cv::UMatUsageFlags usage_flags) const override
+	{
+		return data;
+	}
+
+	virtual void deallocate(cv::UMatData *data) const override
+	{
+		if (!data)
+			return;
+
+		bool destroy = false;
+		if (!(data->flags & cv::UMatData::USER_ALLOCATED))
+			destroy = _give(data->origdata, data->size);
+		delete data;
+
+		if (destroy)
+			delete this;
+	}
+
+	[[nodiscard]]
+	size_t capacity() const noexcept
+	{
+		auto guard = std::lock_guard { _lock };
+		return _capacity;
+	}
+
+	void capacity(size_t capacity)
+	{
+		auto guard = std::lock_guard { _lock };
+		_capacity = capacity;
+		_shrink(capacity);
+		_idle.reserve(capacity);
+	}
+
+	[[nodiscard]]
+	size_t high_water_mark() const noexcept
+	{
+		auto guard = std::lock_guard { _lock };
+		return _high_water_mark;
+	}
+
+	[[nodiscard]]
+	size_t in_use() const noexcept
+	{
+		auto guard = std::lock_guard { _lock };
+		return _in_use;
+	}
+
+	void reserve(size_t count, size_t block_size)
+	{
+		auto guard = std::lock_guard { _lock };
+		if (block_size != _block_size)
+			_retarget(block_size);
+		for (count = std::min(count, _capacity); _idle.size() < count; ++_owned)
+			_idle.push_back(static_cast<cv::uchar *>(cv::fastMalloc(block_size)));
+	}
+
+	void reset_high_water_mark() noexcept
+	{
+		auto guard = std::lock_guard { _lock };
+		_high_water_mark = _in_use;
+	}
+
+	// the allocator destroys itself once the last outstanding buffer is returned
+	void retire() noexcept
+	{
+		bool destroy;
+		{
+			auto guard = std::lock_guard { _lock };
+			_retired = true;
+			destroy = !_outstanding;
+		}
+		if (destroy)
+			delete this;
+	}
+
+	[[nodiscard]]
+	size_t size() const noexcept
+	{
+		auto guard = std::lock_guard { _lock };
+		return _owned;
+	}
+};
+
+frame_pool::frame_pool(size_t capacity) : _allocator(new allocator(capacity)) {}
+
+frame_pool::~frame_pool() noexcept
+{
+	_allocator->retire();
+	_allocator = nullptr;
+}
+
+void frame_pool::acquire(cv::Mat& image, int rows, int cols, int type)
+{
+	image.release();
+	image.allocator = _allocator;
+	image.create(rows, cols, type);
+	// the buffer goes back through its own allocator, while later reallocations by the consumer must not reach the pool
+	image.allocator = nullptr;
+}
+
+[[nodiscard]]
+size_t frame_pool::capacity() const noexcept
+{
+	return _allocator->capacity();
+}
+
+void frame_pool::capacity(size_t capacity)
+{
+	_allocator->capacity(capacity);
+}
+
+[[nodiscard]]
+size_t frame_pool::high_water_mark() const noexcept
+{
+	return _allocator->high_water_mark();
+}
+
+[[nodiscard]]
+size_t frame_pool::in_use() const noexcept
+{
+	return _allocator->in_use();
+}
+
+void frame_pool::reserve(size_t count, int rows, int cols, int type)
+{
+	_allocator->reserve(count, size_t(rows) * cols * CV_ELEM_SIZE(type));
+}
+
+void frame_pool::reset_high_water_mark() noexcept
+{
+	_allocator->reset_high_water_mark();
+}
+
+[[nodiscard]]
+size_t frame_pool::size() const noexcept
+{
+	return _allocator->size();
+}
+
+}
@@ -0,0 +1,52 @@
+#include <cstddef>
+
+#include <stdexcept>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "utilities/camera/base.hpp"
+#include "utilities/camera/pyramid.hpp"
+
+namespace utilities::camera
+{
+
+pyramid_builder::pyramid_builder() :
+	_pools {},
+	_levels(1)
+{}
+
+void pyramid_builder::build(base::frame& frame)
+{
+	if (_levels < 2 || frame.format.raw() || !frame.pyramid[0].empty())
+		return;
+
+	const cv::Mat *previous = &frame.content;
+	for (size_t i = 0; i + 1 < _levels; ++i)
+	{
+		const cv::Size size(previous->cols / 2, previous->rows / 2);
+		if (size.empty())
+			return;
+
+		auto& level = frame.pyramid[i];
+		_pools[i].acquire(level, size.height, size.width, previous->type());
+		// exact halving takes the vectorised path of the area interpolation
+		cv::resize((*previous)(cv::Rect(0, 0, size.width * 2, size.height * 2)), level, size, 0, 0, cv::INTER_AREA);
+		previous = &level;
+	}
+}
+
+[[nodiscard]]
+size_t pyramid_builder::levels() const noexcept
+{
+	return _levels;
+}
+
+void pyramid_builder::levels(size_t levels)
+{
+	if (!levels || levels > base::frame::pyramid_levels)
+		throw std::out_of_range("pyramid levels must be between 1 and frame::pyramid_levels");
+	_levels = levels;
+}
+
+}
@@ -0,0 +1,417 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stop_token>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#include "utilities/camera/base.hpp"
+#include "utilities/camera/recording.hpp"
+
+#include "./container.hpp"
+
+using std::chrono_literals::operator""ms;
+
+namespace utilities::camera
+{
+
+namespace
+{
+
+[[nodiscard]]
+static inline int64_t _nanoseconds(const std::chrono::steady_clock::time_point& time) noexcept
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+}
+
+void recorder::_append(std::vector<base::frame>& batch)
+{
+	// a batch holds as many frames as the writer fell behind by, shared among the encoding threads
+	std::vector<std::vector<uint8_t>> encoded(batch.size());
+	if (_encoding == recording_encoding::PNG)
+		cv::parallel_for_(cv::Range(0, int(batch.size())), [&](const cv::Range& range)
+		{
+			for (int i = range.start; i < range.end; ++i)
+			{
+				// formats PNG cannot hold are stored raw
+				try
+				{
+					if (!cv::imencode(".png", batch[i].content, encoded[i], { cv::IMWRITE_PNG_COMPRESSION, 1 }))
+						encoded[i].clear();
+				}
+				catch (const cv::Exception&)
+				{
+					encoded[i].clear();
+				}
+			}
+		});
+
+	static const char padding[_container::alignment] {};
+	for (size_t i = 0; i < batch.size() && _file; ++i)
+	{
+		const auto& frame = batch[i];
+		const auto& content = frame.content;
+		const bool png = !encoded[i].empty();
+		const uint64_t row = content.cols * content.elemSize();
+		const _container::record_header header {
+			_container::record_magic,
+			uint32_t(png ? recording_encoding::PNG : recording_encoding::RAW),
+			frame.id,
+			frame.block_id,
+			frame.device_timestamp,
+			_nanoseconds(frame.host_timestamp),
+			frame.gap,
+			content.rows,
+			content.cols,
+			content.type(),
+			uint8_t(frame.format.layout),
+			frame.format.depth,
+			uint8_t(frame.format.packed),
+			0,
+			png ? encoded[i].size() : row * content.rows
+		};
+
+		const auto payload = _container::align(_offset + sizeof(header));
+		_file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		_file.write(padding, payload - _offset - sizeof(header));
+		if (png)
+			_file.write(reinterpret_cast<const char *>(encoded[i].data()), encoded[i].size());
+		else if (content.isContinuous())
+			_file.write(reinterpret_cast<const char *>(content.data), header.size);
+		else
+			for (int r = 0; r < content.rows; ++r)
+				_file.write(content.ptr<char>(r), row);
+
+		const auto end = payload + header.size;
+		_file.write(padding, _container::align(end) - end);
+
+		const _container::index_entry entry { header.id, header.host_timestamp, _offset };
+		const auto bytes = reinterpret_cast<const char *>(&entry);
+		_index.insert(_index.end(), bytes, bytes + sizeof(entry));
+		_offset = _container::align(end);
+		_recorded.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// flushed batch by batch, so that a crash loses as little as possible
+	_file.flush();
+	if (!_file)
+	{
+		int expected = 0;
+		_error.compare_exchange_strong(expected, int(std::errc::io_error), std::memory_order_relaxed);
+	}
+}
+
+void recorder::_write(std::stop_token token)
+{
+	const auto batch_size = size_t(std::max(1, cv::getNumThreads()));
+	std::vector<base::frame> batch;
+	base::frame frame;
+	while (true)
+	{
+		if (!_frames.pop(frame, token, 100ms))
+		{
+			if (token.stop_requested())
+				break;
+			continue;
+		}
+		batch.push_back(std::move(frame));
+		while (batch.size() < batch_size && _frames.pop(frame))
+			batch.push_back(std::move(frame));
+		// frames are still taken after a failure, so that the pool gets their buffers back
+		if (_file)
+			_append(batch);
+		batch.clear();
+	}
+
+	// frames recorded before the stop are written too
+	while (_frames.pop(frame))
+		batch.push_back(std::move(frame));
+	if (_file && !batch.empty())
+		_append(batch);
+}
+
+recorder::recorder(
+	const std::filesystem::path& path,
+	const std::string& serial,
+	base::brand brand,
+	recording_encoding encoding,
+	size_t capacity
+) :
+	_file(path, std::ios::binary | std::ios::trunc),
+	_encoding(encoding),
+	_frames(capacity, overflow_policy::DROP_NEWEST),
+	_index {},
+	_offset(0),
+	_recorded(0),
+	_error(0),
+	_stop {},
+	_writer {}
+{
+	_container::file_header header {};
+	std::memcpy(header.magic, _container::file_magic, sizeof(header.magic));
+	header.steady_origin = _nanoseconds(std::chrono::steady_clock::now());
+	header.system_origin = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::system_clock::now().time_since_epoch()
+	).count();
+	header.brand = uint32_t(brand);
+	std::memcpy(header.serial, serial.data(), std::min(serial.size(), sizeof(header.serial) - 1));
+
+	static const char padding[_container::alignment] {};
+	_file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	_offset = _container::align(sizeof(header));
+	_file.write(padding, _offset - sizeof(header));
+	if (!_file)
+		throw std::system_error(std::make_error_code(std::errc::io_error), path.string());
+
+	_writer = std::thread { &recorder::_write, this, _stop.get_token() };
+}
+
+recorder::~recorder() noexcept
+{
+	_stop.request_stop();
+	if (_writer.joinable())
+		_writer.join();
+
+	if (!_file)
+		return;
+	_container::trailer trailer { _index.size() / sizeof(_container::index_entry), _offset, {} };
+	std::memcpy(trailer.magic, _container::index_magic, sizeof(trailer.magic));
+	_file.write(_index.data(), _index.size());
+	_file.write(reinterpret_cast<const char *>(&trailer), sizeof(trailer));
+}
+
+[[nodiscard]]
+size_t recorder::dropped() const noexcept
+{
+	return _frames.dropped();
+}
+
+[[nodiscard]]
+std::error_code recorder::error() noexcept
+{
+	const auto error = _error.exchange(0, std::memory_order_relaxed);
+	return error ? std::make_error_code(std::errc(error)) : std::error_code {};
+}
+
+void recorder::record(const base::frame& frame)
+{
+	if (!frame)
+		return;
+
+	// shares the pixels, which the pool recycles only once written
+	base::frame queued(frame.id, frame.content, frame.format);
+	queued.block_id = frame.block_id;
+	queued.device_timestamp = frame.device_timestamp;
+	queued.host_timestamp = frame.host_timestamp;
+	queued.gap = frame.gap;
+	_frames.push(std::move(queued));
+}
+
+[[nodiscard]]
+size_t recorder::recorded() const noexcept
+{
+	return _recorded.load(std::memory_order_relaxed);
+}
+
+recording::recording(
+	std::unique_ptr<base::device> device,
+	const std::filesystem::path& path,
+	recording_encoding encoding,
+	size_t capacity
+) :
+	_device { std::move(device) },
+	_recorder(path, _device->serial(), _device->brand(), encoding, capacity)
+{}
+
+[[nodiscard]]
+base::device& recording::inner() noexcept
+{
+	return *_device;
+}
+
+[[nodiscard]]
+const recorder& recording::sink() const noexcept
+{
+	return _recorder;
+}
+
+[[nodiscard]]
+const thread_affinity& recording::acquisition_thread() const
+{
+	return _device->acquisition_thread();
+}
+
+void recording::acquisition_thread(thread_affinity affinity)
+{
+	_device->acquisition_thread(std::move(affinity));
+}
+
+[[nodiscard]]
+parameter_report recording::apply(const parameter_set& parameters)
+{
+	return _device->apply(parameters);
+}
+
+[[nodiscard]]
+base::brand recording::brand() const
+{
+	return _device->brand();
+}
+
+void recording::close()
+{
+	_device->close();
+}
+
+[[nodiscard]]
+bool recording::disconnected() const
+{
+	return _device->disconnected();
+}
+
+[[nodiscard]]
+size_t recording::dropped_frames() const
+{
+	return _device->dropped_frames();
+}
+
+void recording::listener(ring_listener *listener)
+{
+	_device->listener(listener);
+}
+
+[[nodiscard]]
+base::frame recording::next_image(std::error_code& ec)
+{
+	ec = _recorder.error();
+	if (ec)
+		return {};
+
+	auto ret = _device->next_image(ec);
+	_recorder.record(ret);
+	return ret;
+}
+
+[[nodiscard]]
+base::frame recording::next_image(
+	std::error_code& ec,
+	std::stop_token token,
+	const std::chrono::nanoseconds& timeout
+)
+{
+	ec = _recorder.error();
+	if (ec)
+		return {};
+
+	auto ret = _device->next_image(ec, std::move(token), timeout);
+	_recorder.record(ret);
+	return ret;
+}
+
+void recording::open()
+{
+	_device->open();
+}
+
+[[nodiscard]]
+frame_pool& recording::pool()
+{
+	return _device->pool();
+}
+
+[[nodiscard]]
+size_t recording::pyramid() const
+{
+	return _device->pyramid();
+}
+
+void recording::pyramid(size_t levels)
+{
+	_device->pyramid(levels);
+}
+
+void recording::queue(size_t capacity, overflow_policy policy)
+{
+	_device->queue(capacity, policy);
+}
+
+[[nodiscard]]
+bool recording::raw() const
+{
+	return _device->raw();
+}
+
+void recording::raw(bool enable)
+{
+	_device->raw(enable);
+}
+
+void recording::reconnect()
+{
+	_device->reconnect();
+}
+
+void recording::reset_statistics()
+{
+	_device->reset_statistics();
+}
+
+[[nodiscard]]
+base::rotation_direction recording::rotation() const
+{
+	return _device->rotation();
+}
+
+void recording::rotation(base::rotation_direction direction)
+{
+	_device->rotation(direction);
+}
+
+[[nodiscard]]
+std::string recording::serial() const
+{
+	return _device->serial();
+}
+
+void recording::start()
+{
+	_device->start();
+}
+
+[[nodiscard]]
+device_statistics::snapshot recording::statistics() const
+{
+	return _device->statistics();
+}
+
+void recording::stop()
+{
+	_device->stop();
+}
+
+void recording::subscribe()
+{
+	_device->subscribe();
+}
+
+void recording::unsubscribe()
+{
+	_device->unsubscribe();
+}
+
+}
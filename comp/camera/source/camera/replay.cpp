@@ -0,0 +1,466 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <mio/mmap.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#include "utilities/camera/base.hpp"
+#include "utilities/camera/develop.hpp"
+#include "utilities/camera/recording.hpp"
+#include "utilities/camera/replay.hpp"
+
+#include "./container.hpp"
+#include "./utils.hpp"
+
+namespace utilities::camera
+{
+
+namespace
+{
+
+// the header at the offset, if it describes a complete record of the file
+[[nodiscard]]
+static std::optional<_container::record_header> _read_record(const char *data, size_t size, uint64_t offset)
+{
+	_container::record_header header;
+	if (offset > size || size - offset < sizeof(header))
+		return {};
+	std::memcpy(&header, data + offset, sizeof(header));
+	if (header.magic != _container::record_magic || header.rows <= 0 || header.cols <= 0)
+		return {};
+
+	const auto payload = _container::align(offset + sizeof(header));
+	if (payload > size || size - payload < header.size)
+		return {};
+	switch (recording_encoding(header.encoding))
+	{
+		case recording_encoding::RAW:
+			if (header.size != uint64_t(header.rows) * header.cols * CV_ELEM_SIZE(header.type))
+				return {};
+			return header;
+		case recording_encoding::PNG:
+			return header;
+	}
+	return {};
+}
+
+// from the index of a cleanly closed recording
+[[nodiscard]]
+static std::optional<std::vector<_container::index_entry>> _read_index(const char *data, size_t size)
+{
+	_container::trailer trailer;
+	if (size < sizeof(trailer))
+		return {};
+	std::memcpy(&trailer, data + size - sizeof(trailer), sizeof(trailer));
+	if (std::memcmp(trailer.magic, _container::index_magic, sizeof(trailer.magic)) || trailer.offset > size - sizeof(trailer))
+		return {};
+	const auto bytes = size - sizeof(trailer) - trailer.offset;
+	if (bytes % sizeof(_container::index_entry) || bytes / sizeof(_container::index_entry) != trailer.count)
+		return {};
+
+	std::vector<_container::index_entry> ret(trailer.count);
+	std::memcpy(ret.data(), data + trailer.offset, ret.size() * sizeof(_container::index_entry));
+	return ret;
+}
+
+// walks the records of a recording cut short, up to the first incomplete one
+[[nodiscard]]
+static std::vector<_container::index_entry> _scan(const char *data, size_t size)
+{
+	std::vector<_container::index_entry> ret;
+	auto offset = _container::align(sizeof(_container::file_header));
+	while (const auto header = _read_record(data, size, offset))
+	{
+		ret.push_back({ header->id, header->host_timestamp, offset });
+		offset = _container::align(_container::align(offset + sizeof(*header)) + header->size);
+	}
+	return ret;
+}
+
+}
+
+replay::replay(const std::filesystem::path& path) :
+	device {},
+	_mapping {},
+	_data(nullptr),
+	_size(0),
+	_records {},
+	_steady_origin(0),
+	_system_origin(0),
+	_brand(base::brand::UNKNOWN),
+	_serial {},
+	_raw(false),
+	_rotation(base::rotation_direction::ORIGINAL),
+	_index(0),
+	_speed(1),
+	_looping(false),
+	_buffers {},
+	_images {},
+	_counter(0),
+	_statistics {},
+	_binder {},
+	_pyramid {},
+	_stop {},
+	_simulation {}
+{
+	std::error_code ec;
+	auto mapping = std::make_shared<mio::mmap_source>();
+	mapping->map(path.string(), ec);
+	if (ec)
+		throw std::system_error(ec, path.string());
+	_data = mapping->data();
+	_size = mapping->size();
+	_mapping = std::move(mapping);
+
+	_container::file_header header;
+	if (_size < sizeof(header) || std::memcmp(_data, _container::file_magic, sizeof(_container::file_magic)))
+		throw std::system_error(std::make_error_code(std::errc::invalid_argument), path.string());
+	std::memcpy(&header, _data, sizeof(header));
+	_steady_origin = header.steady_origin;
+	_system_origin = header.system_origin;
+	_brand = base::brand(header.brand);
+	_serial.assign(header.serial, std::find(header.serial, header.serial + sizeof(header.serial), '\0'));
+
+	auto entries = _read_index(_data, _size);
+	if (!entries)
+		entries = _scan(_data, _size);
+	_records.reserve(entries->size());
+	for (const auto& entry : *entries)
+		if (_read_record(_data, _size, entry.offset))
+			_records.push_back({ entry.id, entry.host_timestamp, entry.offset });
+}
+
+void replay::_emit(const record& record)
+{
+	const auto received = std::chrono::steady_clock::now();
+	const auto header = *_read_record(_data, _size, record.offset);
+	const auto payload = const_cast<char *>(_data + _container::align(record.offset + sizeof(header)));
+	const base::pixel_format format { base::pixel_layout(header.layout), header.depth, bool(header.packed) };
+
+	base::frame frame;
+	if (recording_encoding(header.encoding) == recording_encoding::PNG)
+		frame = { 0, cv::imdecode(cv::Mat(1, int(header.size), CV_8UC1, payload), cv::IMREAD_UNCHANGED), format };
+	else
+		// read-only pages, like the storage shared by zero copy frames
+		frame = { 0, _utils::adopt(cv::Mat(header.rows, header.cols, header.type, payload), _mapping), format };
+	if (frame.content.empty())
+		return;
+
+	if (!_raw && format.raw())
+	{
+		cv::Mat developed;
+		develop(frame, developed, format.layout != base::pixel_layout::MONO, _rotation);
+		frame = { 0, std::move(developed) };
+	}
+	else if (!_raw && _rotation != base::rotation_direction::ORIGINAL)
+		frame = { 0, _utils::rotate(frame.content, _buffers, _rotation) };
+	frame.block_id = header.block_id;
+	frame.device_timestamp = header.device_timestamp;
+	frame.host_timestamp = received;
+	frame.gap = header.gap;
+	_pyramid.build(frame);
+	const auto converted = std::chrono::steady_clock::now();
+	_images.push(std::move(frame));
+	_statistics.record_callback(received, converted, header.gap);
+}
+
+void replay::_simulate(std::stop_token token)
+{
+	if (_records.empty())
+		return;
+	_binder.bind();
+
+	while (!token.stop_requested())
+	{
+		if (_index == _records.size())
+		{
+			if (!_looping)
+				return;
+			_index = 0;
+		}
+
+		// the schedule is anchored to the first frame played, so that production time does not accumulate
+		const auto start = std::chrono::steady_clock::now();
+		const auto first = _records[_index].host_timestamp;
+		for (; _index < _records.size(); ++_index)
+		{
+			const auto& current = _records[_index];
+			if (_speed > 0)
+			{
+				const auto due = start + std::chrono::nanoseconds(int64_t((current.host_timestamp - first) / _speed));
+				if (!_utils::sleep_until(token, due))
+					return;
+			}
+			else if (token.stop_requested())
+				return;
+			_emit(current);
+		}
+	}
+}
+
+[[nodiscard]]
+std::vector<std::unique_ptr<replay>> replay::find(
+	const std::filesystem::path& base,
+	std::vector<std::string> serials
+)
+{
+	std::vector<std::unique_ptr<replay>> ret;
+	ret.reserve(serials.size());
+	for (const auto& serial : serials)
+		if (const auto path = base / (serial + ".rec"); std::filesystem::exists(path))
+			ret.emplace_back(new replay(path));
+	return ret;
+}
+
+[[nodiscard]]
+std::unique_ptr<replay> replay::load(const std::filesystem::path& path)
+{
+	return std::unique_ptr<replay>(new replay(path));
+}
+
+replay::~replay() noexcept
+{
+	stop();
+}
+
+[[nodiscard]]
+const thread_affinity& replay::acquisition_thread() const
+{
+	return _binder.affinity();
+}
+
+void replay::acquisition_thread(thread_affinity affinity)
+{
+	_binder.affinity(std::move(affinity));
+}
+
+[[nodiscard]]
+parameter_report replay::apply(const parameter_set& parameters)
+{
+	return _utils::apply_parameters(
+		parameters,
+		[](const std::string&, parameter_value&, std::error_code& ec)
+		{
+			ec = std::make_error_code(std::errc::operation_not_supported);
+		},
+		[](const std::string&, const parameter_value&, std::error_code& ec)
+		{
+			ec = std::make_error_code(std::errc::operation_not_supported);
+		}
+	);
+}
+
+[[nodiscard]]
+size_t replay::dropped_frames() const
+{
+	return _images.dropped();
+}
+
+void replay::listener(ring_listener *listener)
+{
+	_images.listener(listener);
+}
+
+[[nodiscard]]
+base::frame replay::next_image(std::error_code& ec)
+{
+	ec = _binder.error();
+	if (ec)
+		return {};
+
+	base::frame ret;
+	if (!_images.pop(ret))
+		return {};
+
+	ret.id = ++_counter;
+	_statistics.record_delivery(ret.host_timestamp);
+	return ret;
+}
+
+[[nodiscard]]
+base::frame replay::next_image(
+	std::error_code& ec,
+	std::stop_token token,
+	const std::chrono::nanoseconds& timeout
+)
+{
+	ec = _binder.error();
+	if (ec)
+		return {};
+
+	base::frame ret;
+	if (!_images.pop(ret, std::move(token), timeout))
+		return {};
+
+	ret.id = ++_counter;
+	_statistics.record_delivery(ret.host_timestamp);
+	return ret;
+}
+
+[[nodiscard]]
+frame_pool& replay::pool()
+{
+	return _buffers;
+}
+
+[[nodiscard]]
+size_t replay::pyramid() const
+{
+	return _pyramid.levels();
+}
+
+void replay::pyramid(size_t levels)
+{
+	_pyramid.levels(levels);
+}
+
+void replay::queue(size_t capacity, overflow_policy policy)
+{
+	_images.reset(capacity, policy);
+}
+
+[[nodiscard]]
+bool replay::raw() const
+{
+	return _raw;
+}
+
+void replay::raw(bool enable)
+{
+	_raw = enable;
+}
+
+void replay::reset_statistics()
+{
+	_statistics.reset(_images.dropped());
+}
+
+[[nodiscard]]
+base::rotation_direction replay::rotation() const
+{
+	return _rotation;
+}
+
+void replay::rotation(base::rotation_direction rotation)
+{
+	_rotation = rotation;
+}
+
+[[nodiscard]]
+std::string replay::serial() const
+{
+	return _serial;
+}
+
+void replay::start()
+{
+	_stop = {};
+	_simulation = std::thread { &replay::_simulate, this, _stop.get_token() };
+}
+
+[[nodiscard]]
+device_statistics::snapshot replay::statistics() const
+{
+	return _statistics.take(_images.size(), _images.dropped());
+}
+
+void replay::stop()
+{
+	_stop.request_stop();
+	// a blocked playback would otherwise never observe the stop request
+	if (_images.policy() == overflow_policy::BLOCK)
+		_images.clear();
+	if (_simulation.joinable())
+		_simulation.join();
+}
+
+void replay::subscribe()
+{
+	_images.clear();
+	_counter = 0;
+}
+
+[[nodiscard]]
+size_t replay::frames() const noexcept
+{
+	return _records.size();
+}
+
+void replay::looping(bool enable)
+{
+	_looping = enable;
+}
+
+[[nodiscard]]
+size_t replay::position() const noexcept
+{
+	return _index;
+}
+
+[[nodiscard]]
+bool replay::seek(size_t id)
+{
+	const auto found = std::find_if(
+		_records.begin(),
+		_records.end(),
+		[id](const record& record) { return record.id == id; }
+	);
+	if (found == _records.end())
+		return false;
+	_index = size_t(found - _records.begin());
+	return true;
+}
+
+[[nodiscard]]
+bool replay::seek(const std::chrono::system_clock::time_point& time)
+{
+	// host timestamps follow the steady clock, hence are sorted
+	const auto target = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count() -
+		_system_origin + _steady_origin;
+	const auto found = std::lower_bound(
+		_records.begin(),
+		_records.end(),
+		target,
+		[](const record& record, int64_t target) { return record.host_timestamp < target; }
+	);
+	if (found == _records.end())
+		return false;
+	_index = size_t(found - _records.begin());
+	return true;
+}
+
+[[nodiscard]]
+double replay::speed() const noexcept
+{
+	return _speed;
+}
+
+void replay::speed(double speed)
+{
+	_speed = speed;
+}
+
+[[nodiscard]]
+std::chrono::system_clock::time_point replay::received(size_t index) const
+{
+	const auto& record = _records.at(index);
+	return std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+		std::chrono::nanoseconds(record.host_timestamp - _steady_origin + _system_origin)
+	));
+}
+
+}
@@ -0,0 +1,290 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define _UTILITIES_CAMERA_ROTATION_SSE2
+#include <emmintrin.h>
+#endif
+
+// not part of the x86-64 baseline, hence compiled for its own target and chosen at run time
+#if defined(_UTILITIES_CAMERA_ROTATION_SSE2) && (defined(__GNUC__) || defined(_MSC_VER))
+#define _UTILITIES_CAMERA_ROTATION_SSSE3
+#include <tmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define _UTILITIES_CAMERA_ROTATION_SSSE3_TARGET
+#define _UTILITIES_CAMERA_ROTATION_FLATTEN
+#else
+#define _UTILITIES_CAMERA_ROTATION_SSSE3_TARGET __attribute__((target("ssse3")))
+#define _UTILITIES_CAMERA_ROTATION_FLATTEN __attribute__((flatten))
+#endif
+#endif
+
+#include "./rotation.hpp"
+
+namespace utilities::camera::_utils
+{
+
+namespace
+{
+
+// a block of 64 x 64 pixels keeps both the source rows and the destination rows of a 3-channel image within L1
+static constexpr size_t _block = 64;
+
+// Maps the source pixel (r, c) onto the destination, see rotate_90:
+// - clockwise: destination (c, rows - 1 - r)
+// - counter-clockwise: destination (cols - 1 - c, r)
+template<size_t channels>
+inline void _rotate_tile(
+	const uint8_t *source,
+	size_t source_step,
+	uint8_t *destination,
+	size_t destination_step,
+	size_t rows,
+	size_t cols,
+	bool clockwise,
+	size_t row_begin,
+	size_t row_end,
+	size_t col_begin,
+	size_t col_end
+)
+{
+	for (size_t c = col_begin; c < col_end; ++c)
+	{
+		auto output = clockwise ?
+			destination + c * destination_step :
+			destination + (cols - 1 - c) * destination_step;
+		for (size_t r = row_begin; r < row_end; ++r)
+		{
+			auto input = source + r * source_step + c * channels;
+			auto target = output + (clockwise ? rows - 1 - r : r) * channels;
+			if constexpr (channels == 1)
+				*target = *input;
+			else
+				std::memcpy(target, input, channels);
+		}
+	}
+}
+
+#ifdef _UTILITIES_CAMERA_ROTATION_SSE2
+
+// transposes the 8 x 8 tile at (r, c) with SSE2 unpacks, rows are fed in reverse for a clockwise rotation
+inline void _rotate_8x8(
+	const uint8_t *source,
+	size_t source_step,
+	uint8_t *destination,
+	size_t destination_step,
+	size_t rows,
+	size_t cols,
+	bool clockwise,
+	size_t r,
+	size_t c
+)
+{
+	__m128i a[8];
+	for (size_t i = 0; i < 8; ++i)
+		a[i] = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(
+			source + (clockwise ? r + 7 - i : r + i) * source_step + c
+		));
+
+	auto b0 = _mm_unpacklo_epi8(a[0], a[1]), b1 = _mm_unpacklo_epi8(a[2], a[3]);
+	auto b2 = _mm_unpacklo_epi8(a[4], a[5]), b3 = _mm_unpacklo_epi8(a[6], a[7]);
+	auto c0 = _mm_unpacklo_epi16(b0, b1), c1 = _mm_unpackhi_epi16(b0, b1);
+	auto c2 = _mm_unpacklo_epi16(b2, b3), c3 = _mm_unpackhi_epi16(b2, b3);
+	// each register holds two transposed rows (i.e. source columns)
+	const __m128i d[4] {
+		_mm_unpacklo_epi32(c0, c2),
+		_mm_unpackhi_epi32(c0, c2),
+		_mm_unpacklo_epi32(c1, c3),
+		_mm_unpackhi_epi32(c1, c3)
+	};
+
+	const size_t offset = clockwise ? rows - 8 - r : r;
+	for (size_t i = 0; i < 4; ++i)
+	{
+		const size_t column = c + 2 * i;
+		auto low = destination + (clockwise ? column : cols - 1 - column) * destination_step + offset;
+		auto high = destination + (clockwise ? column + 1 : cols - 2 - column) * destination_step + offset;
+		_mm_storel_epi64(reinterpret_cast<__m128i *>(low), d[i]);
+		_mm_storel_epi64(reinterpret_cast<__m128i *>(high), _mm_unpackhi_epi64(d[i], d[i]));
+	}
+}
+
+#endif
+
+#ifdef _UTILITIES_CAMERA_ROTATION_SSSE3
+
+// same as _rotate_8x8 for 4 x 4 tiles of 3-channel pixels, each pixel widened to 32 bits for the transposition
+_UTILITIES_CAMERA_ROTATION_SSSE3_TARGET
+inline void _rotate_4x4_bgr(
+	const uint8_t *source,
+	size_t source_step,
+	uint8_t *destination,
+	size_t destination_step,
+	size_t rows,
+	size_t cols,
+	bool clockwise,
+	size_t r,
+	size_t c
+)
+{
+	const auto widen = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+	const auto narrow = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+	__m128i a[4];
+	for (size_t i = 0; i < 4; ++i)
+	{
+		// 12 bytes, read as 8 and 4 so as not to run past the end of the image
+		const auto input = source + (clockwise ? r + 3 - i : r + i) * source_step + c * 3;
+		int32_t tail;
+		std::memcpy(&tail, input + 8, sizeof(tail));
+		const auto pixels = _mm_unpacklo_epi64(
+			_mm_loadl_epi64(reinterpret_cast<const __m128i *>(input)),
+			_mm_cvtsi32_si128(tail)
+		);
+		a[i] = _mm_shuffle_epi8(pixels, widen);
+	}
+
+	const auto b0 = _mm_unpacklo_epi32(a[0], a[1]), b1 = _mm_unpacklo_epi32(a[2], a[3]);
+	const auto b2 = _mm_unpackhi_epi32(a[0], a[1]), b3 = _mm_unpackhi_epi32(a[2], a[3]);
+	// each register holds a transposed row, i.e. a source column
+	const __m128i d[4] {
+		_mm_unpacklo_epi64(b0, b1),
+		_mm_unpackhi_epi64(b0, b1),
+		_mm_unpacklo_epi64(b2, b3),
+		_mm_unpackhi_epi64(b2, b3)
+	};
+
+	const size_t offset = (clockwise ? rows - 4 - r : r) * 3;
+	for (size_t i = 0; i < 4; ++i)
+	{
+		const size_t column = c + i;
+		auto output = destination + (clockwise ? column : cols - 1 - column) * destination_step + offset;
+		const auto packed = _mm_shuffle_epi8(d[i], narrow);
+		_mm_storel_epi64(reinterpret_cast<__m128i *>(output), packed);
+		const int32_t tail = _mm_cvtsi128_si32(_mm_srli_si128(packed, 8));
+		std::memcpy(output + 8, &tail, sizeof(tail));
+	}
+}
+
+#endif
+
+// tiles of (tile x tile) pixels are handed to the vector function, the ragged edges of each block being done one by one
+template<size_t channels, size_t tile = 0, auto vector = nullptr>
+inline void _rotate(
+	const uint8_t *source,
+	size_t source_step,
+	uint8_t *destination,
+	size_t destination_step,
+	size_t rows,
+	size_t cols,
+	bool clockwise
+)
+{
+	for (size_t row_block = 0; row_block < rows; row_block += _block)
+	{
+		const auto row_end = std::min(row_block + _block, rows);
+		for (size_t col_block = 0; col_block < cols; col_block += _block)
+		{
+			const auto col_end = std::min(col_block + _block, cols);
+			if constexpr (tile != 0)
+			{
+				const auto row_vector_end = row_block + (row_end - row_block) / tile * tile;
+				const auto col_vector_end = col_block + (col_end - col_block) / tile * tile;
+				for (size_t r = row_block; r < row_vector_end; r += tile)
+					for (size_t c = col_block; c < col_vector_end; c += tile)
+						vector(source, source_step, destination, destination_step, rows, cols, clockwise, r, c);
+				_rotate_tile<channels>(
+					source, source_step, destination, destination_step, rows, cols, clockwise,
+					row_block, row_vector_end, col_vector_end, col_end
+				);
+				_rotate_tile<channels>(
+					source, source_step, destination, destination_step, rows, cols, clockwise,
+					row_vector_end, row_end, col_block, col_end
+				);
+			}
+			else
+				_rotate_tile<channels>(
+					source, source_step, destination, destination_step, rows, cols, clockwise,
+					row_block, row_end, col_block, col_end
+				);
+		}
+	}
+}
+
+#ifdef _UTILITIES_CAMERA_ROTATION_SSSE3
+
+// flattened, so that the whole loop shares the target and the tiles are inlined
+_UTILITIES_CAMERA_ROTATION_SSSE3_TARGET _UTILITIES_CAMERA_ROTATION_FLATTEN
+void _rotate_bgr_ssse3(
+	const uint8_t *source,
+	size_t source_step,
+	uint8_t *destination,
+	size_t destination_step,
+	size_t rows,
+	size_t cols,
+	bool clockwise
+)
+{
+	_rotate<3, 4, _rotate_4x4_bgr>(source, source_step, destination, destination_step, rows, cols, clockwise);
+}
+
+[[nodiscard]]
+static inline bool _has_ssse3() noexcept
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	return info[2] & (1 << 9);
+#else
+	return __builtin_cpu_supports("ssse3");
+#endif
+}
+
+#endif
+
+}
+
+void rotate_90(
+	const uint8_t *source,
+	size_t source_step,
+	uint8_t *destination,
+	size_t destination_step,
+	size_t rows,
+	size_t cols,
+	size_t channels,
+	bool clockwise
+)
+{
+	switch (channels)
+	{
+		case 1:
+#ifdef _UTILITIES_CAMERA_ROTATION_SSE2
+			_rotate<1, 8, _rotate_8x8>(source, source_step, destination, destination_step, rows, cols, clockwise);
+#else
+			_rotate<1>(source, source_step, destination, destination_step, rows, cols, clockwise);
+#endif
+			break;
+		case 3:
+		{
+#ifdef _UTILITIES_CAMERA_ROTATION_SSSE3
+			static const bool ssse3 = _has_ssse3();
+			if (ssse3)
+			{
+				_rotate_bgr_ssse3(source, source_step, destination, destination_step, rows, cols, clockwise);
+				break;
+			}
+#endif
+			_rotate<3>(source, source_step, destination, destination_step, rows, cols, clockwise);
+			break;
+		}
+		default:
+			throw std::invalid_argument("unsupported channel number");
+	}
+}
+
+}
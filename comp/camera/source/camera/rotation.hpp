@@ -0,0 +1,25 @@
+#ifndef __UTILITIES_CAMERA_ROTATION_HPP__
+#define __UTILITIES_CAMERA_ROTATION_HPP__
+
+#include <cstddef>
+#include <cstdint>
+
+namespace utilities::camera::_utils
+{
+
+// Rotates a (rows x cols) image of 1 or 3 interleaved 8-bit channels by 90 degrees into a (cols x rows) image
+// in a single cache-blocked pass, strides are in bytes.
+void rotate_90(
+	const uint8_t *source,
+	size_t source_step,
+	uint8_t *destination,
+	size_t destination_step,
+	size_t rows,
+	size_t cols,
+	size_t channels,
+	bool clockwise
+);
+
+}
+
+#endif
@@ -0,0 +1,861 @@
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <cerrno>
+#  include <csignal>
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+#include <opencv2/core.hpp>
+
+#include "utilities/camera/base.hpp"
+#include "utilities/camera/develop.hpp"
+#include "utilities/camera/shared_memory.hpp"
+
+#include "./utils.hpp"
+
+namespace utilities::camera::_shared_memory
+{
+
+namespace
+{
+
+static constexpr char _magic[8] = { 'C', 'A', 'M', 'S', 'H', 'M', '0', '2' };
+
+static constexpr size_t _alignment = 64;
+
+// consumers attached to a segment at once, each holding slots through a bit of its own
+static constexpr size_t _max_readers = 64;
+
+// entry of a reader whose process is gone, while its bits are being cleared
+static constexpr uint32_t _reclaiming = ~uint32_t(0);
+
+enum class segment_state : uint32_t
+{
+	CREATING,
+	OPEN,
+	CLOSED
+};
+
+static_assert(
+	std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+	"atomics shared across processes must be lock-free"
+);
+
+// Layout of a segment: a segment_header, then the slots, each a slot_header then its pixels, all on 64-byte boundaries.
+struct segment_header final
+{
+	char magic[8];
+	uint32_t slots;
+	uint32_t brand;
+	// bytes of pixels a slot holds
+	uint64_t capacity;
+	// bytes from a slot to the next
+	uint64_t stride;
+	char serial[64];
+	std::atomic<uint32_t> state;
+	// number of the last frame published, frames being numbered from 1
+	std::atomic<uint64_t> published;
+	// process of each attached consumer, 0 if the entry is free
+	std::atomic<uint32_t> readers[_max_readers];
+};
+
+struct slot_header final
+{
+	// twice the number of the frame held, plus one while it is being written
+	std::atomic<uint64_t> sequence;
+	// a bit per reader entry holding the frame, which the publisher then leaves alone
+	std::atomic<uint64_t> holders;
+	int32_t rows;
+	int32_t cols;
+	int32_t type;
+	uint8_t layout;
+	uint8_t depth;
+	uint8_t packed;
+	uint8_t reserved;
+	uint64_t block_id;
+	uint64_t device_timestamp;
+	// steady clock, shared by the processes of a host, in nanoseconds
+	int64_t host_timestamp;
+	uint64_t gap;
+};
+
+[[nodiscard]]
+static inline constexpr size_t _align(size_t value) noexcept
+{
+	return (value + _alignment - 1) / _alignment * _alignment;
+}
+
+[[nodiscard]]
+static std::string _name(const std::string& serial)
+{
+	std::string ret = serial;
+	std::replace_if(ret.begin(), ret.end(), [](char c) { return !std::isalnum(static_cast<unsigned char>(c)); }, '_');
+#ifdef _WIN32
+	return "Local\\utilities-camera-" + ret;
+#else
+	return "/utilities-camera-" + ret;
+#endif
+}
+
+[[nodiscard]]
+static inline uint32_t _process_id() noexcept
+{
+#ifdef _WIN32
+	return uint32_t(::GetCurrentProcessId());
+#else
+	return uint32_t(::getpid());
+#endif
+}
+
+// readers must share the process id namespace of the publisher, and an id reused meanwhile keeps the slots held
+[[nodiscard]]
+static inline bool _alive(uint32_t process) noexcept
+{
+#ifdef _WIN32
+	const auto handle = ::OpenProcess(SYNCHRONIZE, FALSE, DWORD(process));
+	if (!handle)
+		return ::GetLastError() != ERROR_INVALID_PARAMETER;
+	const bool ret = ::WaitForSingleObject(handle, 0) == WAIT_TIMEOUT;
+	::CloseHandle(handle);
+	return ret;
+#else
+	return !::kill(pid_t(process), 0) || errno != ESRCH;
+#endif
+}
+
+}
+
+// A mapped segment, unmapped once neither its device nor any frame of it is alive anymore.
+// Consumers take an entry of the reader table for as long as they map it.
+class segment final
+{
+	std::string _name;
+	bool _owner;
+	char *_data;
+	size_t _size;
+	// the file mapping on Windows, the inode of the shared memory object otherwise
+	uintptr_t _handle;
+	// entry of the reader table, _max_readers for the publisher
+	size_t _reader;
+
+	// returns false if every entry is taken by a live reader
+	[[nodiscard]]
+	bool _attach() noexcept
+	{
+		auto& header = this->header();
+		for (bool reclaimed = false; ; reclaimed = true)
+		{
+			for (size_t i = 0; i < _max_readers; ++i)
+				if (uint32_t expected = 0; header.readers[i].compare_exchange_strong(expected, _process_id(), std::memory_order_acq_rel))
+				{
+					_reader = i;
+					return true;
+				}
+			if (reclaimed || !reclaim())
+				return false;
+		}
+	}
+public:
+	inline segment(std::string name, bool owner, char *data, size_t size, uintptr_t handle) noexcept :
+		_name { std::move(name) },
+		_owner(owner),
+		_data(data),
+		_size(size),
+		_handle(handle),
+		_reader(_max_readers)
+	{}
+
+	segment(const segment&) = delete;
+
+	segment(segment&&) = delete;
+
+	inline ~segment() noexcept
+	{
+		// every frame read through the entry is gone, and with it every bit held
+		if (_reader < _max_readers)
+			header().readers[_reader].store(0, std::memory_order_release);
+#ifdef _WIN32
+		::UnmapViewOfFile(_data);
+		::CloseHandle(reinterpret_cast<::HANDLE>(_handle));
+#else
+		::munmap(_data, _size);
+		if (!_owner)
+			return;
+		// unless already replaced by another publisher
+		if (const auto fd = ::shm_open(_name.c_str(), O_RDONLY, 0); fd >= 0)
+		{
+			struct ::stat status;
+			const bool same = !::fstat(fd, &status) && uintptr_t(status.st_ino) == _handle;
+			::close(fd);
+			if (same)
+				::shm_unlink(_name.c_str());
+		}
+#endif
+	}
+
+	segment& operator=(const segment&) = delete;
+
+	segment& operator=(segment&&) = delete;
+
+	// replaces any segment of the same name, consumers still mapping it keeping their pages
+	[[nodiscard]]
+	static std::shared_ptr<segment> create(const std::string& name, size_t size)
+	{
+#ifdef _WIN32
+		const auto handle = ::CreateFileMappingA(
+			INVALID_HANDLE_VALUE,
+			nullptr,
+			PAGE_READWRITE,
+			DWORD(uint64_t(size) >> 32),
+			DWORD(size),
+			name.c_str()
+		);
+		if (!handle)
+			throw std::system_error(int(::GetLastError()), std::system_category(), name);
+		const auto data = ::MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+		if (!data)
+		{
+			const auto error = int(::GetLastError());
+			::CloseHandle(handle);
+			throw std::system_error(error, std::system_category(), name);
+		}
+		return std::make_shared<segment>(name, true, static_cast<char *>(data), size, reinterpret_cast<uintptr_t>(handle));
+#else
+		::shm_unlink(name.c_str());
+		const auto fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+		if (fd < 0)
+			throw std::system_error(errno, std::generic_category(), name);
+
+		struct ::stat status;
+		if (::ftruncate(fd, off_t(size)) || ::fstat(fd, &status))
+		{
+			const auto error = errno;
+			::close(fd);
+			::shm_unlink(name.c_str());
+			throw std::system_error(error, std::generic_category(), name);
+		}
+		const auto data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		const auto error = errno;
+		::close(fd);
+		if (data == MAP_FAILED)
+		{
+			::shm_unlink(name.c_str());
+			throw std::system_error(error, std::generic_category(), name);
+		}
+		return std::make_shared<segment>(name, true, static_cast<char *>(data), size, uintptr_t(status.st_ino));
+#endif
+	}
+
+	// returns null if there is no such segment or its publisher is not ready
+	[[nodiscard]]
+	static std::shared_ptr<segment> open(std::error_code& ec, const std::string& name)
+	{
+		std::shared_ptr<segment> ret;
+#ifdef _WIN32
+		const auto handle = ::OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name.c_str());
+		if (!handle)
+		{
+			ec.assign(int(::GetLastError()), std::system_category());
+			return {};
+		}
+		const auto data = ::MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+		::MEMORY_BASIC_INFORMATION information {};
+		if (!data || !::VirtualQuery(data, &information, sizeof(information)))
+		{
+			ec.assign(int(::GetLastError()), std::system_category());
+			if (data)
+				::UnmapViewOfFile(data);
+			::CloseHandle(handle);
+			return {};
+		}
+		ret = std::make_shared<segment>(
+			name,
+			false,
+			static_cast<char *>(data),
+			information.RegionSize,
+			reinterpret_cast<uintptr_t>(handle)
+		);
+#else
+		const auto fd = ::shm_open(name.c_str(), O_RDWR, 0);
+		if (fd < 0)
+		{
+			ec.assign(errno, std::generic_category());
+			return {};
+		}
+		struct ::stat status;
+		if (::fstat(fd, &status))
+		{
+			ec.assign(errno, std::generic_category());
+			::close(fd);
+			return {};
+		}
+		// created but not sized yet
+		if (!status.st_size)
+		{
+			ec = std::make_error_code(std::errc::resource_unavailable_try_again);
+			::close(fd);
+			return {};
+		}
+		const auto data = ::mmap(nullptr, size_t(status.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		ec.assign(errno, std::generic_category());
+		::close(fd);
+		if (data == MAP_FAILED)
+			return {};
+		ret = std::make_shared<segment>(name, false, static_cast<char *>(data), size_t(status.st_size), uintptr_t(status.st_ino));
+#endif
+
+		const auto& header = ret->header();
+		if (
+			ret->_size < sizeof(segment_header) ||
+			std::memcmp(header.magic, _magic, sizeof(_magic)) ||
+			header.state.load(std::memory_order_acquire) == uint32_t(segment_state::CREATING) ||
+			ret->_size < _align(sizeof(segment_header)) + header.slots * header.stride
+		)
+		{
+			ec = std::make_error_code(std::errc::resource_unavailable_try_again);
+			return {};
+		}
+		if (!ret->_attach())
+		{
+			ec = std::make_error_code(std::errc::too_many_files_open);
+			return {};
+		}
+		ec.clear();
+		return ret;
+	}
+
+	[[nodiscard]]
+	inline char *data() noexcept
+	{
+		return _data;
+	}
+
+	[[nodiscard]]
+	inline segment_header& header() noexcept
+	{
+		return *reinterpret_cast<segment_header *>(_data);
+	}
+
+	[[nodiscard]]
+	inline char *pixels(size_t index) noexcept
+	{
+		return reinterpret_cast<char *>(&slot(index)) + _align(sizeof(slot_header));
+	}
+
+	// bit of the reader entry in the holders of a slot
+	[[nodiscard]]
+	inline uint64_t reader_bit() const noexcept
+	{
+		return uint64_t(1) << _reader;
+	}
+
+	// frees the entries of the readers whose process is gone along with the slots they held, returns true if any
+	bool reclaim() noexcept
+	{
+		auto& header = this->header();
+		bool ret = false;
+		for (size_t i = 0; i < _max_readers; ++i)
+		{
+			auto process = header.readers[i].load(std::memory_order_acquire);
+			// the one winning the exchange clears the bits, before the entry can be taken again
+			if (
+				!process ||
+				process == _reclaiming ||
+				_alive(process) ||
+				!header.readers[i].compare_exchange_strong(process, _reclaiming, std::memory_order_acq_rel)
+			)
+				continue;
+			for (size_t j = 0; j < header.slots; ++j)
+				slot(j).holders.fetch_and(~(uint64_t(1) << i), std::memory_order_release);
+			header.readers[i].store(0, std::memory_order_release);
+			ret = true;
+		}
+		return ret;
+	}
+
+	[[nodiscard]]
+	inline slot_header& slot(size_t index) noexcept
+	{
+		return *reinterpret_cast<slot_header *>(_data + _align(sizeof(segment_header)) + index * header().stride);
+	}
+};
+
+}
+
+namespace utilities::camera
+{
+
+shared_memory_publisher::shared_memory_publisher(
+	const std::string& serial,
+	base::brand brand,
+	size_t frame_size,
+	size_t slots
+) :
+	_segment {},
+	_cursor(0),
+	_published(0),
+	_dropped(0)
+{
+	using namespace _shared_memory;
+	if (!slots)
+		throw std::invalid_argument("a shared memory segment needs at least a slot");
+
+	const auto stride = _align(_align(sizeof(slot_header)) + frame_size);
+	_segment = segment::create(_name(serial), _align(sizeof(segment_header)) + slots * stride);
+
+	// consumers only look at a segment once its state is set, hence never see it half initialised
+	auto& header = *std::construct_at(reinterpret_cast<segment_header *>(_segment->data()));
+	std::memcpy(header.magic, _magic, sizeof(_magic));
+	header.slots = uint32_t(slots);
+	header.brand = uint32_t(brand);
+	header.capacity = frame_size;
+	header.stride = stride;
+	std::memcpy(header.serial, serial.data(), std::min(serial.size(), sizeof(header.serial) - 1));
+	for (size_t i = 0; i < slots; ++i)
+		std::construct_at(&_segment->slot(i));
+	header.state.store(uint32_t(_shared_memory::segment_state::OPEN), std::memory_order_release);
+}
+
+shared_memory_publisher::~shared_memory_publisher() noexcept
+{
+	if (_segment)
+		_segment->header().state.store(uint32_t(_shared_memory::segment_state::CLOSED), std::memory_order_release);
+}
+
+[[nodiscard]]
+size_t shared_memory_publisher::dropped() const noexcept
+{
+	return _dropped;
+}
+
+bool shared_memory_publisher::publish(const base::frame& frame)
+{
+	auto& header = _segment->header();
+	const auto& content = frame.content;
+	const size_t row = content.cols * content.elemSize();
+	if (!frame || row * content.rows > header.capacity)
+	{
+		++_dropped;
+		return false;
+	}
+
+	const auto number = _published + 1;
+	// every slot held, possibly by crashed consumers, which are then looked for once
+	for (bool reclaimed = false; ; reclaimed = true)
+	{
+		for (size_t attempt = 0; attempt < header.slots; ++attempt)
+		{
+			const auto index = _cursor;
+			_cursor = (_cursor + 1) % header.slots;
+
+			// either the consumer sees the slot being written or the publisher sees the consumer holding it
+			auto& slot = _segment->slot(index);
+			const auto previous = slot.sequence.load(std::memory_order_relaxed);
+			slot.sequence.store(number * 2 + 1, std::memory_order_seq_cst);
+			if (slot.holders.load(std::memory_order_seq_cst))
+			{
+				slot.sequence.store(previous, std::memory_order_release);
+				continue;
+			}
+
+			slot.rows = content.rows;
+			slot.cols = content.cols;
+			slot.type = content.type();
+			slot.layout = uint8_t(frame.format.layout);
+			slot.depth = frame.format.depth;
+			slot.packed = uint8_t(frame.format.packed);
+			slot.block_id = frame.block_id;
+			slot.device_timestamp = frame.device_timestamp;
+			slot.host_timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+				frame.host_timestamp.time_since_epoch()
+			).count();
+			slot.gap = frame.gap;
+			const auto pixels = _segment->pixels(index);
+			if (content.isContinuous())
+				std::memcpy(pixels, content.data, row * content.rows);
+			else
+				for (int r = 0; r < content.rows; ++r)
+					std::memcpy(pixels + r * row, content.ptr(r), row);
+
+			slot.sequence.store(number * 2, std::memory_order_release);
+			header.published.store(number, std::memory_order_release);
+			_published = number;
+			return true;
+		}
+		if (reclaimed || !_segment->reclaim())
+			break;
+	}
+
+	// numbered all the same, so that consumers count it as lost
+	_published = number;
+	++_dropped;
+	return false;
+}
+
+[[nodiscard]]
+uint64_t shared_memory_publisher::published() const noexcept
+{
+	return _published;
+}
+
+shared_memory::shared_memory(std::shared_ptr<_shared_memory::segment> segment) :
+	device {},
+	_segment { std::move(segment) },
+	_serial {},
+	_brand(base::brand::UNKNOWN),
+	_raw(false),
+	_rotation(base::rotation_direction::ORIGINAL),
+	_last(0),
+	_poll_interval(std::chrono::microseconds(200)),
+	_buffers {},
+	_images {},
+	_counter(0),
+	_statistics {},
+	_binder {},
+	_pyramid {},
+	_error(0),
+	_candidates {},
+	_stop {},
+	_receiver {}
+{
+	const auto& header = _segment->header();
+	_serial.assign(header.serial, std::find(header.serial, header.serial + sizeof(header.serial), '\0'));
+	_brand = base::brand(header.brand);
+	_last = header.published.load(std::memory_order_acquire);
+	_candidates.reserve(header.slots);
+}
+
+size_t shared_memory::_poll()
+{
+	auto& header = _segment->header();
+	// the publisher skips the slots held by consumers, so frames are in no particular order
+	_candidates.clear();
+	for (size_t i = 0; i < header.slots; ++i)
+		if (const auto sequence = _segment->slot(i).sequence.load(std::memory_order_acquire); !(sequence & 1) && sequence / 2 > _last)
+			_candidates.emplace_back(sequence / 2, i);
+	std::sort(_candidates.begin(), _candidates.end());
+
+	size_t ret = 0;
+	const auto bit = _segment->reader_bit();
+	for (const auto& [number, index] : _candidates)
+	{
+		auto& slot = _segment->slot(index);
+		slot.holders.fetch_or(bit, std::memory_order_seq_cst);
+		// overwritten since the scan, the frame is lost like any other one skipped
+		if (slot.sequence.load(std::memory_order_seq_cst) != number * 2)
+		{
+			slot.holders.fetch_and(~bit, std::memory_order_release);
+			continue;
+		}
+
+		const auto received = std::chrono::steady_clock::now();
+		// released along with the last cv::Mat referencing the slot, the segment and its reader entry staying until then
+		const std::shared_ptr<void> lease(&slot, [segment = _segment, bit](void *slot)
+		{
+			static_cast<_shared_memory::slot_header *>(slot)->holders.fetch_and(~bit, std::memory_order_release);
+		});
+		const base::pixel_format format { base::pixel_layout(slot.layout), slot.depth, bool(slot.packed) };
+		const cv::Mat view(slot.rows, slot.cols, slot.type, _segment->pixels(index));
+		base::frame frame { 0, _utils::adopt(view, lease), format };
+
+		if (!_raw && format.raw())
+		{
+			cv::Mat developed;
+			develop(frame, developed, format.layout != base::pixel_layout::MONO, _rotation);
+			frame = { 0, std::move(developed) };
+		}
+		else if (!_raw && _rotation != base::rotation_direction::ORIGINAL)
+			frame = { 0, _utils::rotate(frame.content, _buffers, _rotation) };
+		frame.block_id = slot.block_id;
+		frame.device_timestamp = slot.device_timestamp;
+		// latencies then span both processes
+		frame.host_timestamp = std::chrono::steady_clock::time_point(
+			std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(slot.host_timestamp))
+		);
+		frame.gap = slot.gap + (number - _last - 1);
+		_last = number;
+		_pyramid.build(frame);
+		const auto converted = std::chrono::steady_clock::now();
+		const auto gap = frame.gap;
+		_images.push(std::move(frame));
+		_statistics.record_callback(received, converted, gap);
+		++ret;
+	}
+	return ret;
+}
+
+[[nodiscard]]
+bool shared_memory::_closed(base::frame& frame, std::error_code& ec)
+{
+	const auto error = _error.exchange(0, std::memory_order_acquire);
+	if (!error)
+		return false;
+	if (_images.pop(frame))
+	{
+		// reported once those frames are delivered
+		_error.store(error, std::memory_order_relaxed);
+		return true;
+	}
+	ec = std::make_error_code(std::errc(error));
+	return false;
+}
+
+void shared_memory::_receive(std::stop_token token)
+{
+	_binder.bind();
+	while (!token.stop_requested())
+	{
+		if (_poll())
+			continue;
+		if (_segment->header().state.load(std::memory_order_acquire) == uint32_t(_shared_memory::segment_state::CLOSED))
+		{
+			// frames published right before the close
+			_poll();
+			_error.store(int(std::errc::connection_reset), std::memory_order_release);
+			// a consumer waiting for a frame, or a listener, would otherwise only hear of it with the next one
+			_images.wake();
+			return;
+		}
+		std::this_thread::sleep_for(_poll_interval);
+	}
+}
+
+[[nodiscard]]
+std::vector<std::unique_ptr<shared_memory>> shared_memory::find(std::vector<std::string> serials)
+{
+	std::vector<std::unique_ptr<shared_memory>> ret;
+	ret.reserve(serials.size());
+	for (const auto& serial : serials)
+	{
+		std::error_code ec;
+		if (auto segment = _shared_memory::segment::open(ec, _shared_memory::_name(serial)))
+			ret.emplace_back(new shared_memory(std::move(segment)));
+	}
+	return ret;
+}
+
+shared_memory::~shared_memory() noexcept
+{
+	stop();
+}
+
+[[nodiscard]]
+const thread_affinity& shared_memory::acquisition_thread() const
+{
+	return _binder.affinity();
+}
+
+void shared_memory::acquisition_thread(thread_affinity affinity)
+{
+	_binder.affinity(std::move(affinity));
+}
+
+[[nodiscard]]
+parameter_report shared_memory::apply(const parameter_set& parameters)
+{
+	return _utils::apply_parameters(
+		parameters,
+		[](const std::string&, parameter_value&, std::error_code& ec)
+		{
+			ec = std::make_error_code(std::errc::operation_not_supported);
+		},
+		[](const std::string&, const parameter_value&, std::error_code& ec)
+		{
+			ec = std::make_error_code(std::errc::operation_not_supported);
+		}
+	);
+}
+
+void shared_memory::close()
+{
+	stop();
+	// the receiver being gone, this thread stands in for it
+	_images.wake();
+}
+
+[[nodiscard]]
+bool shared_memory::disconnected() const
+{
+	return _segment->header().state.load(std::memory_order_acquire) == uint32_t(_shared_memory::segment_state::CLOSED);
+}
+
+[[nodiscard]]
+size_t shared_memory::dropped_frames() const
+{
+	return _images.dropped();
+}
+
+void shared_memory::listener(ring_listener *listener)
+{
+	_images.listener(listener);
+}
+
+[[nodiscard]]
+base::frame shared_memory::next_image(std::error_code& ec)
+{
+	ec = _binder.error();
+	if (ec)
+		return {};
+
+	base::frame ret;
+	if (!_images.pop(ret) && !_closed(ret, ec))
+		return {};
+
+	ret.id = ++_counter;
+	_statistics.record_delivery(ret.host_timestamp);
+	return ret;
+}
+
+[[nodiscard]]
+base::frame shared_memory::next_image(
+	std::error_code& ec,
+	std::stop_token token,
+	const std::chrono::nanoseconds& timeout
+)
+{
+	ec = _binder.error();
+	if (ec)
+		return {};
+
+	base::frame ret;
+	if (!_images.pop(ret, std::move(token), timeout) && !_closed(ret, ec))
+		return {};
+
+	ret.id = ++_counter;
+	_statistics.record_delivery(ret.host_timestamp);
+	return ret;
+}
+
+[[nodiscard]]
+frame_pool& shared_memory::pool()
+{
+	return _buffers;
+}
+
+[[nodiscard]]
+size_t shared_memory::pyramid() const
+{
+	return _pyramid.levels();
+}
+
+void shared_memory::pyramid(size_t levels)
+{
+	_pyramid.levels(levels);
+}
+
+void shared_memory::queue(size_t capacity, overflow_policy policy)
+{
+	_images.reset(capacity, policy);
+}
+
+[[nodiscard]]
+bool shared_memory::raw() const
+{
+	return _raw;
+}
+
+void shared_memory::raw(bool enable)
+{
+	_raw = enable;
+}
+
+void shared_memory::reconnect()
+{
+	// a publisher started again creates a segment of its own, the one held is left to its remaining readers
+	std::error_code ec;
+	auto segment = _shared_memory::segment::open(ec, _shared_memory::_name(_serial));
+	if (!segment)
+		throw std::system_error(ec, _serial);
+	_segment = std::move(segment);
+	const auto& header = _segment->header();
+	_brand = base::brand(header.brand);
+	_last = header.published.load(std::memory_order_acquire);
+	_candidates.reserve(header.slots);
+	_error.store(0, std::memory_order_relaxed);
+}
+
+void shared_memory::reset_statistics()
+{
+	_statistics.reset(_images.dropped());
+}
+
+[[nodiscard]]
+base::rotation_direction shared_memory::rotation() const
+{
+	return _rotation;
+}
+
+void shared_memory::rotation(base::rotation_direction rotation)
+{
+	_rotation = rotation;
+}
+
+[[nodiscard]]
+std::string shared_memory::serial() const
+{
+	return _serial;
+}
+
+void shared_memory::start()
+{
+	_error.store(0, std::memory_order_relaxed);
+	_stop = {};
+	_receiver = std::thread { &shared_memory::_receive, this, _stop.get_token() };
+}
+
+[[nodiscard]]
+device_statistics::snapshot shared_memory::statistics() const
+{
+	return _statistics.take(_images.size(), _images.dropped());
+}
+
+void shared_memory::stop()
+{
+	_stop.request_stop();
+	// a blocked receiver would otherwise never observe the stop request
+	if (_images.policy() == overflow_policy::BLOCK)
+		_images.clear();
+	if (_receiver.joinable())
+		_receiver.join();
+}
+
+void shared_memory::subscribe()
+{
+	_images.clear();
+	_counter = 0;
+	_last = _segment->header().published.load(std::memory_order_acquire);
+}
+
+[[nodiscard]]
+std::chrono::nanoseconds shared_memory::poll_interval() const
+{
+	return _poll_interval;
+}
+
+void shared_memory::poll_interval(const std::chrono::nanoseconds& interval)
+{
+	_poll_interval = interval;
+}
+
+}
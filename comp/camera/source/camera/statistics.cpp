@@ -0,0 +1,166 @@
+#include <cstddef>
+#include <cstdint>
+
+#include <chrono>
+#include <string>
+
+#include "utilities/camera/statistics.hpp"
+
+#include "./utils.hpp"
+
+namespace utilities::camera
+{
+
+namespace
+{
+
+[[nodiscard]]
+static inline double _milliseconds(const std::chrono::nanoseconds& duration) noexcept
+{
+	return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+[[nodiscard]]
+static inline std::chrono::nanoseconds _mean(const std::chrono::nanoseconds& total, size_t count) noexcept
+{
+	return count ? total / int64_t(count) : std::chrono::nanoseconds {};
+}
+
+}
+
+[[nodiscard]]
+double device_statistics::snapshot::frame_rate() const noexcept
+{
+	const auto seconds = std::chrono::duration<double>(elapsed).count();
+	return seconds > 0 ? received / seconds : 0;
+}
+
+[[nodiscard]]
+std::chrono::microseconds device_statistics::snapshot::latency_quantile(double quantile) const noexcept
+{
+	size_t total = 0;
+	for (auto count : latency)
+		total += count;
+	if (!total)
+		return {};
+
+	size_t cumulated = 0;
+	for (size_t i = 0; i < latency.size(); ++i)
+	{
+		cumulated += latency[i];
+		if (cumulated >= quantile * total)
+			return std::chrono::microseconds(int64_t(1) << i);
+	}
+	return std::chrono::microseconds(int64_t(1) << (latency.size() - 1));
+}
+
+[[nodiscard]]
+std::string device_statistics::snapshot::json() const
+{
+	std::string histogram;
+	for (size_t i = 0; i < latency.size(); ++i)
+		histogram += _UTILITIES_FORMAT_STRING("{}{}", i ? "," : "", latency[i]);
+
+	return _UTILITIES_FORMAT_STRING(
+		"{{\"elapsed_ms\":{:.3f},\"received\":{},\"delivered\":{},\"dropped\":{},\"lost\":{},\"queued\":{},"
+		"\"frame_rate\":{:.3f},\"callback_mean_ms\":{:.3f},\"callback_max_ms\":{:.3f},"
+		"\"conversion_mean_ms\":{:.3f},\"conversion_max_ms\":{:.3f},\"idle_ms\":{:.3f},"
+		"\"latency_p50_us\":{},\"latency_p99_us\":{},\"latency_log2_us\":[{}]}}",
+		_milliseconds(elapsed),
+		received,
+		delivered,
+		dropped,
+		lost,
+		queued,
+		frame_rate(),
+		_milliseconds(_mean(callback_total, received)),
+		_milliseconds(callback_max),
+		_milliseconds(_mean(conversion_total, received)),
+		_milliseconds(conversion_max),
+		_milliseconds(idle),
+		latency_quantile(0.5).count(),
+		latency_quantile(0.99).count(),
+		histogram
+	);
+}
+
+[[nodiscard]]
+std::string device_statistics::snapshot::text() const
+{
+	return _UTILITIES_FORMAT_STRING(
+		"{:.2f} fps, received {}, delivered {}, dropped {}, lost {}, queued {}, "
+		"callback {:.3f}/{:.3f} ms, conversion {:.3f}/{:.3f} ms (mean/max), idle {:.3f} ms, "
+		"latency p50 <= {} us, p99 <= {} us",
+		frame_rate(),
+		received,
+		delivered,
+		dropped,
+		lost,
+		queued,
+		_milliseconds(_mean(callback_total, received)),
+		_milliseconds(callback_max),
+		_milliseconds(_mean(conversion_total, received)),
+		_milliseconds(conversion_max),
+		_milliseconds(idle),
+		latency_quantile(0.5).count(),
+		latency_quantile(0.99).count()
+	);
+}
+
+device_statistics::device_statistics() noexcept :
+	_since(_now()),
+	_dropped_base(0),
+	_received(0),
+	_lost(0),
+	_callback_total(0),
+	_callback_max(0),
+	_conversion_total(0),
+	_conversion_max(0),
+	_last_received(0),
+	_delivered(0),
+	_latency {}
+{}
+
+void device_statistics::reset(size_t dropped) noexcept
+{
+	_dropped_base.store(dropped, std::memory_order_relaxed);
+	_received.store(0, std::memory_order_relaxed);
+	_lost.store(0, std::memory_order_relaxed);
+	_callback_total.store(0, std::memory_order_relaxed);
+	_callback_max.store(0, std::memory_order_relaxed);
+	_conversion_total.store(0, std::memory_order_relaxed);
+	_conversion_max.store(0, std::memory_order_relaxed);
+	_last_received.store(0, std::memory_order_relaxed);
+	_delivered.store(0, std::memory_order_relaxed);
+	for (auto& bucket : _latency)
+		bucket.store(0, std::memory_order_relaxed);
+	_since.store(_now(), std::memory_order_relaxed);
+}
+
+[[nodiscard]]
+device_statistics::snapshot device_statistics::take(size_t queued, size_t dropped) const noexcept
+{
+	const auto now = _now();
+	const auto since = _since.load(std::memory_order_relaxed);
+	const auto last_received = _last_received.load(std::memory_order_relaxed);
+	const auto dropped_base = _dropped_base.load(std::memory_order_relaxed);
+
+	snapshot ret {};
+	ret.elapsed = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(now - since));
+	ret.received = _received.load(std::memory_order_relaxed);
+	ret.delivered = _delivered.load(std::memory_order_relaxed);
+	// a queue sized again since the reset counts from zero once more
+	ret.dropped = dropped >= dropped_base ? dropped - dropped_base : dropped;
+	ret.lost = _lost.load(std::memory_order_relaxed);
+	ret.queued = queued;
+	ret.callback_total = std::chrono::nanoseconds(_callback_total.load(std::memory_order_relaxed));
+	ret.callback_max = std::chrono::nanoseconds(_callback_max.load(std::memory_order_relaxed));
+	ret.conversion_total = std::chrono::nanoseconds(_conversion_total.load(std::memory_order_relaxed));
+	ret.conversion_max = std::chrono::nanoseconds(_conversion_max.load(std::memory_order_relaxed));
+	ret.idle = std::chrono::nanoseconds(now - std::max(since, last_received));
+	for (size_t i = 0; i < _latency.size(); ++i)
+		ret.latency[i] = _latency[i].load(std::memory_order_relaxed);
+	return ret;
+}
+
+}
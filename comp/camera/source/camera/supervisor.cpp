@@ -0,0 +1,432 @@
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "utilities/camera/base.hpp"
+#include "utilities/camera/supervisor.hpp"
+
+#include "./utils.hpp"
+
+namespace utilities::camera
+{
+
+void supervisor::_notify(connection_state state, const std::error_code& ec)
+{
+	_state = state;
+	if (_handler)
+		_handler(state, ec);
+}
+
+void supervisor::_recover(const std::stop_token& token, std::unique_lock<std::mutex>& lock, const std::error_code& cause)
+{
+	_notify(connection_state::LOST, cause);
+	// the device is released once, control calls made in between attempts leave it alone
+	_release();
+	while (!token.stop_requested())
+	{
+		_notify(connection_state::RECONNECTING, {});
+		std::error_code ec;
+		try
+		{
+			_device->reconnect();
+			ec = _restore();
+			++_reconnections;
+			_notify(connection_state::CONNECTED, ec);
+			return;
+		}
+		catch (const std::system_error& e)
+		{
+			ec = e.code();
+		}
+		catch (...)
+		{
+			ec = std::make_error_code(std::errc::io_error);
+		}
+		// a restore failing halfway may leave the device subscribed or started, which reconnect must not find
+		_release();
+		_notify(connection_state::LOST, ec);
+
+		lock.unlock();
+		const bool waited = _utils::sleep_until(token, std::chrono::steady_clock::now() + _retry_interval);
+		lock.lock();
+		// reconnected by hand meanwhile, which another attempt would release and restore all over again
+		if (!waited || _state == connection_state::CONNECTED)
+			return;
+		// closed and stopped meanwhile, there is nothing left to restore until opened again
+		if (!_opened && !_started)
+			return;
+	}
+}
+
+void supervisor::_release() noexcept
+{
+	try
+	{
+		if (_started)
+			_device->stop();
+	}
+	catch (...) {}
+	try
+	{
+		if (_subscribed)
+			_device->unsubscribe();
+	}
+	catch (...) {}
+}
+
+[[nodiscard]]
+std::error_code supervisor::_restore()
+{
+	std::error_code ret;
+	for (const auto& parameters : _applied)
+		if (const auto report = _device->apply(parameters); !report && !ret)
+			ret = report.failures.front().ec;
+	if (_subscribed)
+		_device->subscribe();
+	if (_started)
+	{
+		_device->start();
+		_started_at = std::chrono::steady_clock::now();
+	}
+	return ret;
+}
+
+void supervisor::_watch(std::stop_token token)
+{
+	while (_utils::sleep_until(token, std::chrono::steady_clock::now() + check_interval))
+	{
+		std::unique_lock lock(_lock);
+		std::error_code cause;
+		// a recovery given up on while neither opened nor started is resumed once either is
+		if (_state != connection_state::CONNECTED)
+		{
+			if (_opened || _started)
+				cause = std::make_error_code(std::errc::no_such_device);
+		}
+		else if ((_opened || _started) && _device->disconnected())
+			cause = std::make_error_code(std::errc::no_such_device);
+		// a frame received before the start does not count, hence the start itself has to be old enough
+		else if (
+			_started &&
+			_frame_timeout.count() &&
+			std::chrono::steady_clock::now() - _started_at > _frame_timeout &&
+			_device->statistics().idle > _frame_timeout
+		)
+			cause = std::make_error_code(std::errc::timed_out);
+		if (cause)
+			_recover(token, lock, cause);
+	}
+}
+
+supervisor::supervisor(
+	std::unique_ptr<base::device> device,
+	connection_handler handler,
+	const std::chrono::nanoseconds& frame_timeout,
+	const std::chrono::nanoseconds& retry_interval
+) :
+	_device { std::move(device) },
+	_handler { std::move(handler) },
+	_frame_timeout(frame_timeout),
+	_retry_interval(retry_interval),
+	_applied {},
+	_opened(false),
+	_subscribed(false),
+	_started(false),
+	_started_at {},
+	_state(connection_state::CONNECTED),
+	_counter(0),
+	_reconnections(0),
+	_lock {},
+	_stop {},
+	_watchdog {}
+{
+	_watchdog = std::thread { &supervisor::_watch, this, _stop.get_token() };
+}
+
+supervisor::~supervisor() noexcept
+{
+	_stop.request_stop();
+	if (_watchdog.joinable())
+		_watchdog.join();
+}
+
+[[nodiscard]]
+base::device& supervisor::inner() noexcept
+{
+	return *_device;
+}
+
+[[nodiscard]]
+size_t supervisor::reconnections() const noexcept
+{
+	return _reconnections;
+}
+
+[[nodiscard]]
+connection_state supervisor::state() const noexcept
+{
+	return _state;
+}
+
+[[nodiscard]]
+const thread_affinity& supervisor::acquisition_thread() const
+{
+	return _device->acquisition_thread();
+}
+
+void supervisor::acquisition_thread(thread_affinity affinity)
+{
+	std::lock_guard guard(_lock);
+	_device->acquisition_thread(std::move(affinity));
+}
+
+[[nodiscard]]
+parameter_report supervisor::apply(const parameter_set& parameters)
+{
+	std::lock_guard guard(_lock);
+	auto ret = _device->apply(parameters);
+	if (!ret)
+		return ret;
+
+	const auto same_nodes = [&](const parameter_set& applied)
+	{
+		return std::equal(
+			applied.begin(),
+			applied.end(),
+			parameters.begin(),
+			parameters.end(),
+			[](const parameter& lhs, const parameter& rhs) { return lhs.name == rhs.name; }
+		);
+	};
+	std::erase_if(_applied, same_nodes);
+	_applied.push_back(parameters);
+	return ret;
+}
+
+[[nodiscard]]
+base::brand supervisor::brand() const
+{
+	return _device->brand();
+}
+
+void supervisor::close()
+{
+	std::lock_guard guard(_lock);
+	if (_state == connection_state::CONNECTED)
+		_device->close();
+	_opened = false;
+}
+
+[[nodiscard]]
+bool supervisor::disconnected() const
+{
+	return _state != connection_state::CONNECTED;
+}
+
+[[nodiscard]]
+size_t supervisor::dropped_frames() const
+{
+	return _device->dropped_frames();
+}
+
+void supervisor::listener(ring_listener *listener)
+{
+	std::lock_guard guard(_lock);
+	_device->listener(listener);
+}
+
+[[nodiscard]]
+base::frame supervisor::next_image(std::error_code& ec)
+{
+	auto ret = _device->next_image(ec);
+	if (ec && _state != connection_state::CONNECTED)
+		ec.clear();
+	if (ret)
+		ret.id = ++_counter;
+	return ret;
+}
+
+[[nodiscard]]
+base::frame supervisor::next_image(
+	std::error_code& ec,
+	std::stop_token token,
+	const std::chrono::nanoseconds& timeout
+)
+{
+	auto ret = _device->next_image(ec, std::move(token), timeout);
+	if (ec && _state != connection_state::CONNECTED)
+		ec.clear();
+	if (ret)
+		ret.id = ++_counter;
+	return ret;
+}
+
+void supervisor::open()
+{
+	std::lock_guard guard(_lock);
+	if (_state == connection_state::CONNECTED)
+		_device->open();
+	_opened = true;
+}
+
+[[nodiscard]]
+frame_pool& supervisor::pool()
+{
+	return _device->pool();
+}
+
+[[nodiscard]]
+size_t supervisor::pyramid() const
+{
+	return _device->pyramid();
+}
+
+void supervisor::pyramid(size_t levels)
+{
+	std::lock_guard guard(_lock);
+	_device->pyramid(levels);
+}
+
+void supervisor::queue(size_t capacity, overflow_policy policy)
+{
+	std::lock_guard guard(_lock);
+	_device->queue(capacity, policy);
+}
+
+[[nodiscard]]
+bool supervisor::raw() const
+{
+	return _device->raw();
+}
+
+void supervisor::raw(bool enable)
+{
+	std::lock_guard guard(_lock);
+	_device->raw(enable);
+}
+
+void supervisor::reconnect()
+{
+	std::lock_guard guard(_lock);
+	if (_state == connection_state::CONNECTED)
+		_release();
+	std::error_code ec;
+	try
+	{
+		_device->reconnect();
+		ec = _restore();
+	}
+	catch (...)
+	{
+		// left to the watchdog, which retries from a released device
+		_release();
+		_state = connection_state::LOST;
+		throw;
+	}
+	++_reconnections;
+	_state = connection_state::CONNECTED;
+	if (ec)
+		throw std::system_error(ec);
+}
+
+void supervisor::reset_statistics()
+{
+	_device->reset_statistics();
+}
+
+[[nodiscard]]
+base::rotation_direction supervisor::rotation() const
+{
+	return _device->rotation();
+}
+
+void supervisor::rotation(base::rotation_direction rotation)
+{
+	std::lock_guard guard(_lock);
+	_device->rotation(rotation);
+}
+
+[[nodiscard]]
+std::string supervisor::serial() const
+{
+	return _device->serial();
+}
+
+void supervisor::start()
+{
+	std::lock_guard guard(_lock);
+	if (_state == connection_state::CONNECTED)
+		_device->start();
+	_started = true;
+	_started_at = std::chrono::steady_clock::now();
+}
+
+[[nodiscard]]
+device_statistics::snapshot supervisor::statistics() const
+{
+	return _device->statistics();
+}
+
+void supervisor::stop()
+{
+	std::lock_guard guard(_lock);
+	if (_state == connection_state::CONNECTED)
+		_device->stop();
+	_started = false;
+}
+
+void supervisor::subscribe()
+{
+	std::lock_guard guard(_lock);
+	if (_state == connection_state::CONNECTED)
+		_device->subscribe();
+	_subscribed = true;
+	_counter = 0;
+}
+
+void supervisor::unsubscribe()
+{
+	std::lock_guard guard(_lock);
+	if (_state == connection_state::CONNECTED)
+		_device->unsubscribe();
+	_subscribed = false;
+}
+
+[[nodiscard]]
+std::chrono::nanoseconds supervisor::frame_timeout() const
+{
+	std::lock_guard guard(_lock);
+	return _frame_timeout;
+}
+
+void supervisor::frame_timeout(const std::chrono::nanoseconds& timeout)
+{
+	std::lock_guard guard(_lock);
+	_frame_timeout = timeout;
+}
+
+[[nodiscard]]
+std::chrono::nanoseconds supervisor::retry_interval() const
+{
+	std::lock_guard guard(_lock);
+	return _retry_interval;
+}
+
+void supervisor::retry_interval(const std::chrono::nanoseconds& interval)
+{
+	std::lock_guard guard(_lock);
+	_retry_interval = interval;
+}
+
+}
@@ -0,0 +1,138 @@
+#include <cstddef>
+
+#include <atomic>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <pthread.h>
+#  include <sched.h>
+#endif
+
+#include "utilities/camera/thread.hpp"
+
+namespace utilities::camera
+{
+
+void bind_current_thread(std::error_code& ec, const thread_affinity& affinity)
+{
+	ec.clear();
+#ifdef _WIN32
+	if (!affinity.cpus.empty())
+	{
+		DWORD_PTR mask = 0;
+		for (auto cpu : affinity.cpus)
+		{
+			if (cpu >= sizeof(mask) * 8)
+			{
+				ec = std::make_error_code(std::errc::invalid_argument);
+				return;
+			}
+			mask |= DWORD_PTR(1) << cpu;
+		}
+		if (!::SetThreadAffinityMask(::GetCurrentThread(), mask))
+		{
+			ec = std::error_code(int(::GetLastError()), std::system_category());
+			return;
+		}
+	}
+	if (affinity.priority && !::SetThreadPriority(::GetCurrentThread(), *affinity.priority))
+		ec = std::error_code(int(::GetLastError()), std::system_category());
+#else
+	if (!affinity.cpus.empty())
+	{
+		::cpu_set_t set;
+		CPU_ZERO(&set);
+		for (auto cpu : affinity.cpus)
+		{
+			if (cpu >= CPU_SETSIZE)
+			{
+				ec = std::make_error_code(std::errc::invalid_argument);
+				return;
+			}
+			CPU_SET(cpu, &set);
+		}
+		if (const auto error = ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set))
+		{
+			ec = std::error_code(error, std::system_category());
+			return;
+		}
+	}
+	if (affinity.priority)
+	{
+		::sched_param parameters {};
+		parameters.sched_priority = *affinity.priority;
+		if (const auto error = ::pthread_setschedparam(::pthread_self(), SCHED_FIFO, &parameters))
+			ec = std::error_code(error, std::system_category());
+	}
+#endif
+}
+
+void bind_current_thread(const thread_affinity& affinity)
+{
+	std::error_code ec;
+	bind_current_thread(ec, affinity);
+	if (ec)
+		throw std::system_error(ec);
+}
+
+thread_binder::thread_binder() noexcept :
+	_affinity {},
+	_bound {},
+	_failed(false),
+	_error_lock {},
+	_error {}
+{}
+
+[[nodiscard]]
+const thread_affinity& thread_binder::affinity() const noexcept
+{
+	return _affinity;
+}
+
+void thread_binder::affinity(thread_affinity affinity)
+{
+	_affinity = std::move(affinity);
+	_bound.store({}, std::memory_order_relaxed);
+	auto guard = std::lock_guard { _error_lock };
+	_error.clear();
+	_failed.store(false, std::memory_order_relaxed);
+}
+
+void thread_binder::bind() noexcept
+{
+	if (_affinity.empty())
+		return;
+
+	// SDKs may hand callbacks over to another thread, e.g. across a restart of the acquisition
+	const auto current = std::this_thread::get_id();
+	if (current == _bound.load(std::memory_order_relaxed))
+		return;
+
+	_bound.store(current, std::memory_order_relaxed);
+	std::error_code ec;
+	bind_current_thread(ec, _affinity);
+	if (ec)
+	{
+		auto guard = std::lock_guard { _error_lock };
+		_error = ec;
+		_failed.store(true, std::memory_order_release);
+	}
+}
+
+[[nodiscard]]
+std::error_code thread_binder::error() noexcept
+{
+	if (!_failed.load(std::memory_order_acquire))
+		return {};
+
+	auto guard = std::lock_guard { _error_lock };
+	_failed.store(false, std::memory_order_relaxed);
+	return std::exchange(_error, {});
+}
+
+}
@@ -1,11 +1,23 @@
 #ifndef __UTILITIES_CAMERA_UTILS_HPP__
 #define __UTILITIES_CAMERA_UTILS_HPP__
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <chrono>
 #ifndef _UTILITIES_USE_FMT
 #include <format>
 #endif
+#include <optional>
 #include <stdexcept>
+#include <stop_token>
+#include <system_error>
+#include <thread>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 #ifdef _UTILITIES_USE_FMT
 #include <fmt/compile.h>
@@ -15,6 +27,10 @@
 #include <opencv2/core.hpp>
 
 #include "utilities/camera/base.hpp"
+#include "utilities/camera/parameters.hpp"
+#include "utilities/camera/pool.hpp"
+
+#include "./rotation.hpp"
 
 #ifdef _UTILITIES_USE_FMT
 #define _UTILITIES_FORMAT_STRING(_F, ...) fmt::format(FMT_COMPILE(_F), __VA_ARGS__)
@@ -42,19 +58,371 @@ static inline void rotate(const cv::Mat& image, cv::Mat& output, base::rotation_
 			image.copyTo(output);
 			break;
 		case base::rotation_direction::CLOCKWISE_90:
-			cv::transpose(image, output);
-			cv::flip(output, output, 1);
+		case base::rotation_direction::COUNTER_CLOCKWISE_90:
+			// single tiled pass instead of a transposition followed by a flip
+			if (
+				(image.type() == CV_8UC1 || image.type() == CV_8UC3) &&
+				&image != &output &&
+				(!output.data || output.data != image.data)
+			)
+			{
+				output.create(image.cols, image.rows, image.type());
+				rotate_90(
+					image.data,
+					image.step[0],
+					output.data,
+					output.step[0],
+					image.rows,
+					image.cols,
+					image.channels(),
+					direction == base::rotation_direction::CLOCKWISE_90
+				);
+			}
+			else
+			{
+				cv::transpose(image, output);
+				cv::flip(output, output, direction == base::rotation_direction::CLOCKWISE_90 ? 1 : 0);
+			}
 			break;
 		case base::rotation_direction::ANY_180:
+			// already a single vectorised pass
 			cv::flip(image, output, -1);
 			break;
+		default:
+			throw std::invalid_argument("invalid rotation direction");
+	}
+}
+
+static inline void acquire_rotated(
+	frame_pool& pool,
+	cv::Mat& output,
+	int rows,
+	int cols,
+	int type,
+	base::rotation_direction direction
+)
+{
+	switch (direction)
+	{
+		case base::rotation_direction::CLOCKWISE_90:
 		case base::rotation_direction::COUNTER_CLOCKWISE_90:
-			cv::transpose(image, output);
-			cv::flip(output, output, 0);
+			pool.acquire(output, cols, rows, type);
 			break;
 		default:
-			throw std::invalid_argument("invalid rotation direction");
+			pool.acquire(output, rows, cols, type);
+	}
+}
+
+[[nodiscard]]
+static inline cv::Mat rotate(const cv::Mat& image, frame_pool& pool, base::rotation_direction direction)
+{
+	cv::Mat output;
+	acquire_rotated(pool, output, image.rows, image.cols, image.type(), direction);
+	rotate(image, output, direction);
+	return output;
+}
+
+// counts the block ids skipped since the previous frame of the stream, wrapped or restarted ids count as none
+[[nodiscard]]
+static inline size_t gap(std::optional<uint64_t>& last_block_id, uint64_t block_id) noexcept
+{
+	const auto previous = std::exchange(last_block_id, block_id);
+	return previous && block_id > *previous ? block_id - *previous - 1 : 0;
+}
+
+// maps the GigE Vision pixel format codes, which every supported SDK reuses, onto the formats a raw frame may carry
+[[nodiscard]]
+static inline std::optional<base::pixel_format> gvsp_pixel_format(uint32_t code)
+{
+	using enum base::pixel_layout;
+	switch (code)
+	{
+		case 0x01080001:
+			return base::pixel_format { MONO, 8, false };
+		case 0x01100003:
+			return base::pixel_format { MONO, 10, false };
+		case 0x010C0004:
+			return base::pixel_format { MONO, 10, true };
+		case 0x01100005:
+			return base::pixel_format { MONO, 12, false };
+		case 0x010C0006:
+			return base::pixel_format { MONO, 12, true };
+		case 0x01080008:
+			return base::pixel_format { BAYER_GR, 8, false };
+		case 0x01080009:
+			return base::pixel_format { BAYER_RG, 8, false };
+		case 0x0108000A:
+			return base::pixel_format { BAYER_GB, 8, false };
+		case 0x0108000B:
+			return base::pixel_format { BAYER_BG, 8, false };
+		case 0x0110000C:
+			return base::pixel_format { BAYER_GR, 10, false };
+		case 0x0110000D:
+			return base::pixel_format { BAYER_RG, 10, false };
+		case 0x0110000E:
+			return base::pixel_format { BAYER_GB, 10, false };
+		case 0x0110000F:
+			return base::pixel_format { BAYER_BG, 10, false };
+		case 0x01100010:
+			return base::pixel_format { BAYER_GR, 12, false };
+		case 0x01100011:
+			return base::pixel_format { BAYER_RG, 12, false };
+		case 0x01100012:
+			return base::pixel_format { BAYER_GB, 12, false };
+		case 0x01100013:
+			return base::pixel_format { BAYER_BG, 12, false };
+		case 0x010C0026:
+			return base::pixel_format { BAYER_GR, 10, true };
+		case 0x010C0027:
+			return base::pixel_format { BAYER_RG, 10, true };
+		case 0x010C0028:
+			return base::pixel_format { BAYER_GB, 10, true };
+		case 0x010C0029:
+			return base::pixel_format { BAYER_BG, 10, true };
+		case 0x010C002A:
+			return base::pixel_format { BAYER_GR, 12, true };
+		case 0x010C002B:
+			return base::pixel_format { BAYER_RG, 12, true };
+		case 0x010C002C:
+			return base::pixel_format { BAYER_GB, 12, true };
+		case 0x010C002D:
+			return base::pixel_format { BAYER_BG, 12, true };
+		case 0x02180015:
+			return base::pixel_format { BGR, 8, false };
+		default:
+			return std::nullopt;
+	}
+}
+
+// columns and type of the image holding the raw pixels of a sensor frame of the given format
+[[nodiscard]]
+static inline std::pair<int, int> raw_layout(int cols, const base::pixel_format& format) noexcept
+{
+	// pairs of samples take 3 bytes, a trailing odd one 2
+	if (format.packed)
+		return { (cols * 3 + 1) / 2, CV_8UC1 };
+	if (format.depth > 8)
+		return { cols, CV_16UC1 };
+	return { cols, format.layout == base::pixel_layout::BGR ? CV_8UC3 : CV_8UC1 };
+}
+
+// wraps the raw pixels of a sensor frame of the given format, without copying
+[[nodiscard]]
+static inline cv::Mat raw_view(void *data, size_t size, int rows, int cols, const base::pixel_format& format)
+{
+	const auto [raw_cols, type] = raw_layout(cols, format);
+	cv::Mat ret(rows, raw_cols, type, data);
+	// truncated frames are left to the conversion of the SDK to report
+	if (ret.step[0] * ret.rows > size)
+		return {};
+	return ret;
+}
+
+// copies a raw sensor frame into a pooled buffer, returns an empty image if it is truncated
+[[nodiscard]]
+static inline cv::Mat copy_raw(
+	frame_pool& pool,
+	void *data,
+	size_t size,
+	int rows,
+	int cols,
+	const base::pixel_format& format
+)
+{
+	auto view = raw_view(data, size, rows, cols, format);
+	if (view.empty())
+		return {};
+
+	cv::Mat ret;
+	pool.acquire(ret, view.rows, view.cols, view.type());
+	std::memcpy(ret.data, view.data, view.step[0] * view.rows);
+	return ret;
+}
+
+// sizes the pool for the raw frames of a sensor, left to size lazily if the format is not one kept raw
+static inline void reserve_raw(frame_pool& pool, size_t count, int rows, int cols, uint32_t code)
+{
+	if (const auto format = gvsp_pixel_format(code))
+	{
+		const auto [raw_cols, type] = raw_layout(cols, *format);
+		pool.reserve(count, rows, raw_cols, type);
+	}
+}
+
+// releases an owner of externally allocated pixels together with the last cv::Mat referencing them
+template<typename T>
+class owner_allocator final : public cv::MatAllocator
+{
+public:
+	[[nodiscard]]
+	static const owner_allocator& instance()
+	{
+		static const owner_allocator ret;
+		return ret;
+	}
+
+	// only reached through cv::Mat::create, which never hands out adopted storage
+	[[nodiscard]]
+	virtual cv::UMatData *allocate(
+		int dims,
+		const int *sizes,
+		int type,
+		void *data,
+		size_t *step,
+		cv::AccessFlag flags,
+		cv::UMatUsageFlags usage_flags
+	) const override
+	{
+		return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usage_flags);
+	}
+
+	[[nodiscard]]
+	virtual bool allocate(cv::UMatData *data, cv::AccessFlag flags, cv::UMatUsageFlags usage_flags) const override
+	{
+		return data;
+	}
+
+	virtual void deallocate(cv::UMatData *data) const override
+	{
+		if (!data)
+			return;
+
+		delete static_cast<T *>(data->userdata);
+		delete data;
+	}
+};
+
+// wraps a view over foreign pixels into a cv::Mat that keeps their owner alive, without copying
+template<typename T>
+[[nodiscard]]
+static inline cv::Mat adopt(const cv::Mat& view, T owner)
+{
+	auto data = new cv::UMatData(&owner_allocator<T>::instance());
+	data->data = data->origdata = view.data;
+	data->size = view.step[0] * view.rows;
+	data->flags |= cv::UMatData::USER_ALLOCATED;
+	data->userdata = new T(std::move(owner));
+
+	auto ret = view;
+	ret.u = data;
+	ret.addref();
+	return ret;
+}
+
+// GenICam integer node, which only accepts min + k * increment up to max
+struct integer_node final
+{
+	int64_t value;
+	int64_t min;
+	int64_t max;
+	int64_t increment;
+
+	[[nodiscard]]
+	inline int64_t floor(int64_t target) const noexcept
+	{
+		target = std::clamp(target, min, max);
+		return increment > 1 ? min + (target - min) / increment * increment : target;
+	}
+
+	[[nodiscard]]
+	inline int64_t ceil(int64_t target) const noexcept
+	{
+		target = std::clamp(target, min, max);
+		const auto ret = increment > 1 ? min + (target - min + increment - 1) / increment * increment : target;
+		return ret > max ? floor(max) : ret;
+	}
+};
+
+// sets the sensor window through the standard nodes, widening it to the increments so that it still covers the request
+// get(name, integer_node&) and set(name, int64_t) return false on failure, an empty window meaning the whole sensor
+template<typename Get, typename Set>
+[[nodiscard]]
+static inline bool apply_roi(const cv::Rect& roi, Get&& get, Set&& set)
+{
+	// offsets first, the maximum size depending on them
+	if (!set("OffsetX", 0) || !set("OffsetY", 0))
+		return false;
+
+	integer_node width, height, x, y;
+	if (!get("Width", width) || !get("Height", height) || !get("OffsetX", x) || !get("OffsetY", y))
+		return false;
+	if (roi.empty())
+		return set("Width", width.floor(width.max)) && set("Height", height.floor(height.max));
+
+	// offsets are only bounded by the sensor once the size is known
+	x.max = width.max;
+	y.max = height.max;
+	const auto left = x.floor(roi.x), top = y.floor(roi.y);
+	const auto columns = width.ceil(roi.x + roi.width - left), rows = height.ceil(roi.y + roi.height - top);
+	return set("Width", columns) &&
+		set("Height", rows) &&
+		set("OffsetX", x.floor(std::min(left, width.max - columns))) &&
+		set("OffsetY", y.floor(std::min(top, height.max - rows)));
+}
+
+template<typename Get>
+[[nodiscard]]
+static inline bool read_roi(cv::Rect& roi, Get&& get)
+{
+	integer_node width, height, x, y;
+	if (!get("Width", width) || !get("Height", height) || !get("OffsetX", x) || !get("OffsetY", y))
+		return false;
+	roi = { int(x.value), int(y.value), int(width.value), int(height.value) };
+	return true;
+}
+
+// sleeps in bounded steps to observe stop requests, returns false if stopped
+[[nodiscard]]
+static inline bool sleep_until(const std::stop_token& token, std::chrono::steady_clock::time_point deadline)
+{
+	while (!token.stop_requested())
+	{
+		const auto now = std::chrono::steady_clock::now();
+		if (now >= deadline)
+			return true;
+		std::this_thread::sleep_until(std::min(deadline, now + std::chrono::milliseconds(10)));
+	}
+	return false;
+}
+
+// writes every parameter in order, then undoes the successful writes in reverse order if any failed
+// read(name, parameter_value&, ec) fills the alternative it is given, write(name, const parameter_value&, ec) sets it
+template<typename Read, typename Write>
+[[nodiscard]]
+static inline parameter_report apply_parameters(const parameter_set& parameters, Read&& read, Write&& write)
+{
+	parameter_report ret;
+	std::vector<std::pair<size_t, parameter_value>> applied;
+	applied.reserve(parameters.size());
+
+	size_t index = 0;
+	for (const auto& [name, value] : parameters)
+	{
+		auto previous = value;
+		std::error_code ec;
+		read(name, previous, ec);
+		if (!ec)
+			write(name, value, ec);
+		if (ec)
+			ret.failures.push_back({ index, name, ec });
+		else
+			applied.emplace_back(index, std::move(previous));
+		++index;
+	}
+	if (ret.failures.empty())
+		return ret;
+
+	// selectors being restored after the nodes they address
+	ret.rolled_back = true;
+	for (auto current = applied.rbegin(); current != applied.rend(); ++current)
+	{
+		const auto& name = parameters.begin()[current->first].name;
+		std::error_code ec;
+		write(name, current->second, ec);
+		if (ec)
+			ret.rollback_failures.push_back({ current->first, name, ec });
 	}
+	return ret;
 }
 
 }
@@ -0,0 +1,120 @@
+#include <cstddef>
+
+#include <coroutine>
+#include <exception>
+#include <system_error>
+#include <utility>
+
+#include <fmt/core.h>
+#include <opencv2/core.hpp>
+
+#include "utilities/camera/base.hpp"
+#include "utilities/camera/event_loop.hpp"
+
+#include "./device.hpp"
+
+namespace
+{
+
+using namespace utilities::camera;
+
+// runs eagerly up to its first suspension, and is destroyed with its frame by the owner
+struct task final
+{
+	struct promise_type final
+	{
+		[[nodiscard]]
+		inline task get_return_object() noexcept
+		{
+			return { std::coroutine_handle<promise_type>::from_promise(*this) };
+		}
+
+		[[nodiscard]]
+		inline std::suspend_never initial_suspend() const noexcept
+		{
+			return {};
+		}
+
+		[[nodiscard]]
+		inline std::suspend_always final_suspend() const noexcept
+		{
+			return {};
+		}
+
+		inline void return_void() const noexcept {}
+
+		inline void unhandled_exception() const noexcept
+		{
+			std::terminate();
+		}
+	};
+
+	std::coroutine_handle<promise_type> handle;
+
+	inline void destroy() noexcept
+	{
+		if (handle)
+			std::exchange(handle, nullptr).destroy();
+	}
+};
+
+[[nodiscard]]
+static inline task _await(base::device& device, event_loop& loop, size_t& received)
+{
+	auto frame = co_await device.next_frame(loop);
+	received = frame.id;
+}
+
+// a frame pushed after the suspension resumes the coroutine on the loop
+[[nodiscard]]
+static inline bool _resumed_on_push()
+{
+	bool ok = true;
+	test::scripted_device device;
+	event_loop loop;
+	size_t received = 0;
+	auto awaiting = _await(device, loop, received);
+	loop.poll();
+	ok = test::expect(!received && !awaiting.handle.done(), "suspended while the queue is empty") && ok;
+
+	device.push(cv::Mat(2, 2, CV_8UC1));
+	loop.poll();
+	ok = test::expect(received == 1 && awaiting.handle.done(), "resumed with the frame pushed") && ok;
+	awaiting.destroy();
+	return ok;
+}
+
+// a suspended coroutine destroyed is neither notified nor run anymore, and leaves the frames queued
+[[nodiscard]]
+static inline bool _destroyed_while_suspended(bool polled)
+{
+	bool ok = true;
+	test::scripted_device device;
+	event_loop loop;
+	size_t received = 0;
+	auto awaiting = _await(device, loop, received);
+	if (polled)
+		loop.poll();
+	awaiting.destroy();
+	ok = test::expect(!loop.pending(), "the awaiter is taken off the loop") && ok;
+
+	device.push(cv::Mat(2, 2, CV_8UC1));
+	ok = test::expect(!loop.pending() && !loop.poll(), "a later frame posts nothing") && ok;
+	ok = test::expect(!received, "the coroutine is not resumed") && ok;
+
+	std::error_code ec;
+	ok = test::expect(bool(device.next_image(ec)), "the frame is left in the queue") && ok;
+	return ok;
+}
+
+}
+
+int main()
+{
+	bool ok = true;
+	ok = _resumed_on_push() && ok;
+	ok = _destroyed_while_suspended(false) && ok;
+	ok = _destroyed_while_suspended(true) && ok;
+	fmt::print("base: {}\n", ok ? "passed" : "failed");
+	return ok ? 0 : 1;
+}
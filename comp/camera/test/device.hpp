@@ -0,0 +1,270 @@
+#ifndef __UTILITIES_CAMERA_TEST_DEVICE_HPP__
+#define __UTILITIES_CAMERA_TEST_DEVICE_HPP__
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <chrono>
+#include <stop_token>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#include <fmt/core.h>
+#include <opencv2/core.hpp>
+
+#include "utilities/camera/base.hpp"
+#include "utilities/camera/pool.hpp"
+#include "utilities/camera/ring.hpp"
+#include "utilities/camera/statistics.hpp"
+#include "utilities/camera/thread.hpp"
+
+namespace utilities::camera::test
+{
+
+// prints the failed expectation, to be chained as ok = expect(...) && ok
+[[nodiscard]]
+inline bool expect(bool condition, const char *what)
+{
+	if (!condition)
+		fmt::print("FAILED: {}\n", what);
+	return condition;
+}
+
+// polls the condition until it holds or the timeout expires
+template<typename F>
+[[nodiscard]]
+inline bool eventually(F&& condition, const std::chrono::milliseconds& timeout = std::chrono::seconds(5))
+{
+	const auto deadline = std::chrono::steady_clock::now() + timeout;
+	while (!condition())
+	{
+		if (std::chrono::steady_clock::now() > deadline)
+			return false;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return true;
+}
+
+// Device driven by the test: frames are pushed by hand from any thread acting as the SDK one,
+// and the connection is lost or refused on demand.
+class scripted_device final : public base::device
+{
+	frame_pool _buffers;
+	ring<base::frame> _images;
+	std::atomic<size_t> _counter;
+	device_statistics _statistics;
+	thread_affinity _affinity;
+	base::rotation_direction _rotation;
+	bool _raw;
+	size_t _pyramid;
+public:
+	// set by the test
+	std::atomic<bool> lost;
+	// reconnect throws while set
+	std::atomic<bool> refused;
+
+	// counted by the device
+	std::atomic<size_t> reconnect_attempts;
+	std::atomic<size_t> starts;
+	std::atomic<size_t> stops;
+	std::atomic<bool> started;
+	std::atomic<bool> subscribed;
+
+	inline scripted_device() :
+		_buffers {},
+		_images {},
+		_counter(0),
+		_statistics {},
+		_affinity {},
+		_rotation(base::rotation_direction::ORIGINAL),
+		_raw(false),
+		_pyramid(1),
+		lost(false),
+		refused(false),
+		reconnect_attempts(0),
+		starts(0),
+		stops(0),
+		started(false),
+		subscribed(false)
+	{}
+
+	// producer side, returns false if the frame has been dropped
+	inline bool push(cv::Mat content)
+	{
+		const auto received = std::chrono::steady_clock::now();
+		base::frame frame { ++_counter, std::move(content) };
+		frame.host_timestamp = received;
+		_statistics.record_callback(received, received, 0);
+		return _images.push(std::move(frame));
+	}
+
+	// base::device
+
+	[[nodiscard]]
+	inline virtual const thread_affinity& acquisition_thread() const override
+	{
+		return _affinity;
+	}
+
+	inline virtual void acquisition_thread(thread_affinity affinity) override
+	{
+		_affinity = std::move(affinity);
+	}
+
+	[[nodiscard]]
+	inline virtual parameter_report apply(const parameter_set& parameters) override
+	{
+		return {};
+	}
+
+	[[nodiscard]]
+	inline virtual base::brand brand() const override
+	{
+		return base::brand::UNKNOWN;
+	}
+
+	inline virtual void close() override {}
+
+	[[nodiscard]]
+	inline virtual bool disconnected() const override
+	{
+		return lost;
+	}
+
+	[[nodiscard]]
+	inline virtual size_t dropped_frames() const override
+	{
+		return _images.dropped();
+	}
+
+	inline virtual void listener(ring_listener *listener) override
+	{
+		_images.listener(listener);
+	}
+
+	using base::device::next_image;
+
+	[[nodiscard]]
+	inline virtual base::frame next_image(std::error_code& ec) override
+	{
+		ec.clear();
+		base::frame ret;
+		if (_images.pop(ret))
+			_statistics.record_delivery(ret.host_timestamp);
+		return ret;
+	}
+
+	[[nodiscard]]
+	inline virtual base::frame next_image(
+		std::error_code& ec,
+		std::stop_token token,
+		const std::chrono::nanoseconds& timeout
+	) override
+	{
+		ec.clear();
+		base::frame ret;
+		if (_images.pop(ret, std::move(token), timeout))
+			_statistics.record_delivery(ret.host_timestamp);
+		return ret;
+	}
+
+	inline virtual void open() override {}
+
+	[[nodiscard]]
+	inline virtual frame_pool& pool() override
+	{
+		return _buffers;
+	}
+
+	[[nodiscard]]
+	inline virtual size_t pyramid() const override
+	{
+		return _pyramid;
+	}
+
+	inline virtual void pyramid(size_t levels) override
+	{
+		_pyramid = levels;
+	}
+
+	inline virtual void queue(size_t capacity, overflow_policy policy) override
+	{
+		_images.reset(capacity, policy);
+	}
+
+	[[nodiscard]]
+	inline virtual bool raw() const override
+	{
+		return _raw;
+	}
+
+	inline virtual void raw(bool enable) override
+	{
+		_raw = enable;
+	}
+
+	inline virtual void reconnect() override
+	{
+		++reconnect_attempts;
+		if (refused)
+			throw std::system_error(std::make_error_code(std::errc::no_such_device));
+		lost = false;
+	}
+
+	inline virtual void reset_statistics() override
+	{
+		_statistics.reset(_images.dropped());
+	}
+
+	[[nodiscard]]
+	inline virtual base::rotation_direction rotation() const override
+	{
+		return _rotation;
+	}
+
+	inline virtual void rotation(base::rotation_direction rotation) override
+	{
+		_rotation = rotation;
+	}
+
+	[[nodiscard]]
+	inline virtual std::string serial() const override
+	{
+		return "scripted";
+	}
+
+	inline virtual void start() override
+	{
+		++starts;
+		started = true;
+	}
+
+	[[nodiscard]]
+	inline virtual device_statistics::snapshot statistics() const override
+	{
+		return _statistics.take(_images.size(), _images.dropped());
+	}
+
+	inline virtual void stop() override
+	{
+		++stops;
+		started = false;
+	}
+
+	inline virtual void subscribe() override
+	{
+		subscribed = true;
+	}
+
+	inline virtual void unsubscribe() override
+	{
+		subscribed = false;
+	}
+};
+
+}
+
+#endif
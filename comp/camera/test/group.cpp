@@ -0,0 +1,115 @@
+#include <cstddef>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fmt/core.h>
+#include <opencv2/core.hpp>
+
+#include "utilities/camera/group.hpp"
+
+#include "./device.hpp"
+
+namespace
+{
+
+using namespace utilities::camera;
+
+static constexpr std::chrono::milliseconds _timeout { 50 };
+
+[[nodiscard]]
+static inline std::unique_ptr<group> _group(
+	std::vector<test::scripted_device *>& devices,
+	size_t count,
+	const std::chrono::nanoseconds& timeout = _timeout
+)
+{
+	std::vector<std::unique_ptr<base::device>> owned;
+	for (size_t i = 0; i < count; ++i)
+	{
+		auto device = std::make_unique<test::scripted_device>();
+		devices.push_back(device.get());
+		owned.push_back(std::move(device));
+	}
+	return std::make_unique<group>(std::move(owned), group::alignment::FRAME_ID, 0, timeout);
+}
+
+// frames of the same number make a set, in order
+[[nodiscard]]
+static inline bool _complete_sets()
+{
+	bool ok = true;
+	std::vector<test::scripted_device *> devices;
+	auto grouped = _group(devices, 2);
+	grouped->start();
+	for (size_t i = 0; i < 3; ++i)
+		for (auto device : devices)
+			device->push(cv::Mat(2, 2, CV_8UC1));
+
+	for (size_t i = 1; i <= 3; ++i)
+	{
+		const auto set = grouped->next_set({}, std::chrono::seconds(5));
+		ok = test::expect(set.id == i && set.complete(), "a complete set per frame number") && ok;
+		ok = test::expect(set && set.frames[0].id == i && set.frames[1].id == i, "the frames of a set match") && ok;
+	}
+	ok = test::expect(!grouped->incomplete_sets() && !grouped->dropped_sets(), "nothing incomplete nor dropped") && ok;
+	grouped->stop();
+	return ok;
+}
+
+// a set a device never completes is dropped once stale
+[[nodiscard]]
+static inline bool _incomplete_dropped()
+{
+	bool ok = true;
+	std::vector<test::scripted_device *> devices;
+	auto grouped = _group(devices, 2);
+	grouped->start();
+	devices[0]->push(cv::Mat(2, 2, CV_8UC1));
+
+	ok = test::expect(!grouped->next_set({}, _timeout * 4), "no set is delivered") && ok;
+	ok = test::expect(
+		test::eventually([&] { return grouped->incomplete_sets() == 1 && grouped->dropped_sets() == 1; }),
+		"the stale set is counted as incomplete and dropped"
+	) && ok;
+	grouped->stop();
+	return ok;
+}
+
+// a puller blocked on a full queue leaves the consumer side free to make room
+[[nodiscard]]
+static inline bool _blocked_puller()
+{
+	bool ok = true;
+	std::vector<test::scripted_device *> devices;
+	// long enough for the sets opened meanwhile not to go stale
+	auto grouped = _group(devices, 2, std::chrono::seconds(5));
+	grouped->queue(1, overflow_policy::BLOCK);
+	grouped->start();
+	for (size_t i = 0; i < 3; ++i)
+		for (auto device : devices)
+			device->push(cv::Mat(2, 2, CV_8UC1));
+	// the second set now waits for room, its puller holding the group lock
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+	ok = test::expect(!grouped->dropped_sets() && !grouped->incomplete_sets(), "the counters are read meanwhile") && ok;
+	for (size_t i = 1; i <= 3; ++i)
+		ok = test::expect(grouped->next_set({}, std::chrono::seconds(5)).id == i, "every set is delivered in turn") && ok;
+	grouped->stop();
+	return ok;
+}
+
+}
+
+int main()
+{
+	bool ok = true;
+	ok = _complete_sets() && ok;
+	ok = _incomplete_dropped() && ok;
+	ok = _blocked_puller() && ok;
+	fmt::print("group: {}\n", ok ? "passed" : "failed");
+	return ok ? 0 : 1;
+}
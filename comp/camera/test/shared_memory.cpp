@@ -0,0 +1,230 @@
+#include <cstddef>
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#  include <fcntl.h>
+#  include <sys/wait.h>
+#  include <unistd.h>
+#endif
+
+#include <fmt/core.h>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#include "utilities/camera/fake.hpp"
+#include "utilities/camera/shared_memory.hpp"
+
+#include "./device.hpp"
+
+namespace
+{
+
+using namespace utilities::camera;
+
+static constexpr int _rows = 8;
+static constexpr int _cols = 16;
+static constexpr size_t _slots = 4;
+
+// images of a single grey level each, told apart by their first pixel
+[[nodiscard]]
+static inline std::filesystem::path _write_images(const std::string& serial)
+{
+	const auto ret = std::filesystem::temp_directory_path() / "utilities-camera-shared-memory-test";
+	std::filesystem::create_directories(ret / serial);
+	for (int i = 0; i < 3; ++i)
+		cv::imwrite((ret / serial / fmt::format("{}.png", i)).string(), cv::Mat(_rows, _cols, CV_8UC1, cv::Scalar(10 * i + 1)));
+	return ret;
+}
+
+[[nodiscard]]
+static inline std::unique_ptr<fake> _producer(const std::filesystem::path& base, const std::string& serial)
+{
+	auto found = fake::find(base, { serial }, false, std::chrono::milliseconds(1), fake::loading::EAGER);
+	if (found.empty())
+		return {};
+	found.front()->subscribe();
+	found.front()->start();
+	return std::move(found.front());
+}
+
+// takes the next frame of the fake and publishes it, returning it
+static inline base::frame _pump(fake& producer, shared_memory_publisher& publisher, bool& published)
+{
+	auto ret = producer.wait_next_image(std::chrono::seconds(1));
+	published = ret && publisher.publish(ret);
+	return ret;
+}
+
+// frames read from a thread of their own match the ones published
+[[nodiscard]]
+static inline bool _round_trip(fake& producer, const std::string& serial)
+{
+	bool ok = true;
+	shared_memory_publisher publisher { serial, producer.brand(), _rows * _cols, _slots };
+	auto readers = shared_memory::find({ serial });
+	if (!test::expect(readers.size() == 1, "the reader attaches"))
+		return false;
+	auto& reader = *readers.front();
+	reader.subscribe();
+	reader.start();
+
+	std::vector<base::frame> received;
+	std::thread consumer { [&]
+	{
+		for (size_t i = 0; i < 3; ++i)
+			if (auto frame = reader.wait_next_image(std::chrono::seconds(5)))
+				received.push_back(std::move(frame));
+	} };
+	std::vector<cv::Mat> sent;
+	for (size_t i = 0; i < 3; ++i)
+	{
+		bool published;
+		auto frame = _pump(producer, publisher, published);
+		ok = test::expect(published, "a free slot is found") && ok;
+		sent.push_back(frame.content.clone());
+		// the consumer holding at most a frame at a time, slots are never all taken
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	}
+	consumer.join();
+
+	if (!test::expect(received.size() == sent.size(), "every frame is received"))
+		return false;
+	for (size_t i = 0; i < sent.size(); ++i)
+		ok = test::expect(cv::norm(sent[i], received[i].content, cv::NORM_INF) == 0, "the pixels are the published ones") && ok;
+	reader.stop();
+	return ok;
+}
+
+// a consumer waiting for a frame hears of the publisher closing at once, rather than once the wait times out
+[[nodiscard]]
+static inline bool _close_wakes(fake& producer, const std::string& serial)
+{
+	bool ok = true;
+	auto publisher = std::make_unique<shared_memory_publisher>(serial, producer.brand(), _rows * _cols, _slots);
+	auto readers = shared_memory::find({ serial });
+	if (!test::expect(readers.size() == 1, "the reader attaches"))
+		return false;
+	auto& reader = *readers.front();
+	reader.subscribe();
+	reader.start();
+
+	std::error_code ec;
+	std::chrono::steady_clock::duration waited {};
+	std::thread consumer { [&]
+	{
+		const auto begin = std::chrono::steady_clock::now();
+		auto frame = reader.next_image(ec, {}, std::chrono::seconds(30));
+		waited = std::chrono::steady_clock::now() - begin;
+	} };
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	publisher.reset();
+	consumer.join();
+
+	ok = test::expect(ec == std::errc::connection_reset, "the close is reported") && ok;
+	ok = test::expect(waited < std::chrono::seconds(5), "the waiting consumer is woken") && ok;
+	reader.stop();
+	return ok;
+}
+
+#ifndef _WIN32
+
+// the slots held by a reader process that died without releasing them are freed by the publisher
+[[nodiscard]]
+static inline bool _crashed_reader(fake& producer, const std::string& serial)
+{
+	bool ok = true;
+	shared_memory_publisher publisher { serial, producer.brand(), _rows * _cols, _slots };
+	int ready[2];
+	if (!test::expect(!::pipe(ready), "a pipe is created"))
+		return false;
+	::fcntl(ready[0], F_SETFL, O_NONBLOCK);
+
+	const auto child = ::fork();
+	if (!child)
+	{
+		// holds every slot, then exits without releasing them
+		::close(ready[0]);
+		auto readers = shared_memory::find({ serial });
+		if (readers.size() != 1)
+			::_exit(1);
+		readers.front()->subscribe();
+		readers.front()->start();
+		const char attached = 'a';
+		if (::write(ready[1], &attached, 1) != 1)
+			::_exit(1);
+		std::vector<base::frame> held;
+		while (held.size() < _slots)
+			if (auto frame = readers.front()->wait_next_image(std::chrono::seconds(5)))
+				held.push_back(std::move(frame));
+			else
+				::_exit(1);
+		const char holding = 'h';
+		if (::write(ready[1], &holding, 1) != 1)
+			::_exit(1);
+		::_exit(0);
+	}
+	::close(ready[1]);
+	if (!test::expect(child > 0, "the reader process is forked"))
+		return false;
+
+	// published once the child is attached, until it holds every slot
+	char state = 0;
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while (state != 'h' && std::chrono::steady_clock::now() < deadline)
+	{
+		if (char read; ::read(ready[0], &read, 1) == 1)
+			state = read;
+		else if (state == 'a')
+		{
+			bool published;
+			_pump(producer, publisher, published);
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+		else
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	::close(ready[0]);
+	int status = 0;
+	::waitpid(child, &status, 0);
+	if (!test::expect(state == 'h' && WIFEXITED(status) && !WEXITSTATUS(status), "the reader process holds every slot"))
+		return false;
+
+	const auto dropped = publisher.dropped();
+	bool published;
+	_pump(producer, publisher, published);
+	ok = test::expect(published && publisher.dropped() == dropped, "the slots of the dead reader are reclaimed") && ok;
+	return ok;
+}
+
+#endif
+
+}
+
+int main()
+{
+	const auto serial = fmt::format("shared-memory-test-{}", std::chrono::steady_clock::now().time_since_epoch().count());
+	const auto base = _write_images(serial);
+	auto producer = _producer(base, serial);
+	bool ok = test::expect(bool(producer), "the fake producer is found");
+	if (ok)
+	{
+		ok = _round_trip(*producer, serial) && ok;
+		ok = _close_wakes(*producer, serial) && ok;
+#ifndef _WIN32
+		ok = _crashed_reader(*producer, serial) && ok;
+#endif
+		producer->stop();
+	}
+	std::error_code ec;
+	std::filesystem::remove_all(base / serial, ec);
+	fmt::print("shared_memory: {}\n", ok ? "passed" : "failed");
+	return ok ? 0 : 1;
+}
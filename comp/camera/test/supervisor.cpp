@@ -0,0 +1,82 @@
+#include <cstddef>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include <fmt/core.h>
+
+#include "utilities/camera/supervisor.hpp"
+
+#include "./device.hpp"
+
+namespace
+{
+
+using namespace utilities::camera;
+
+// a manual reconnection made while the watchdog waits between attempts must not be redone once it wakes up
+[[nodiscard]]
+static inline bool _manual_reconnect_during_backoff()
+{
+	bool ok = true;
+	auto owned = std::make_unique<test::scripted_device>();
+	auto& device = *owned;
+	supervisor supervised { std::move(owned), {}, std::chrono::nanoseconds::zero(), std::chrono::seconds(1) };
+	supervised.subscribe();
+	supervised.start();
+
+	device.refused = true;
+	device.lost = true;
+	ok = test::expect(
+		test::eventually([&] { return device.reconnect_attempts >= 1 && supervised.state() == connection_state::LOST; }),
+		"the first attempt fails"
+	) && ok;
+
+	// lands within the retry interval, the watchdog sleeping without the lock
+	device.refused = false;
+	supervised.reconnect();
+	const size_t attempts = device.reconnect_attempts, starts = device.starts, stops = device.stops;
+	ok = test::expect(supervised.state() == connection_state::CONNECTED, "connected by hand") && ok;
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+	ok = test::expect(device.reconnect_attempts == attempts, "no attempt once the backoff expires") && ok;
+	ok = test::expect(device.starts == starts && device.stops == stops, "the acquisition is left alone") && ok;
+	ok = test::expect(supervised.reconnections() == 1, "reconnected once") && ok;
+	ok = test::expect(supervised.state() == connection_state::CONNECTED && device.started, "still started") && ok;
+	return ok;
+}
+
+// the watchdog alone brings the device back once it is reachable again
+[[nodiscard]]
+static inline bool _automatic_reconnect()
+{
+	bool ok = true;
+	auto owned = std::make_unique<test::scripted_device>();
+	auto& device = *owned;
+	supervisor supervised { std::move(owned), {}, std::chrono::nanoseconds::zero(), std::chrono::milliseconds(50) };
+	supervised.subscribe();
+	supervised.start();
+
+	device.refused = true;
+	device.lost = true;
+	ok = test::expect(test::eventually([&] { return device.reconnect_attempts >= 2; }), "attempts are retried") && ok;
+	device.refused = false;
+	ok = test::expect(
+		test::eventually([&] { return supervised.state() == connection_state::CONNECTED; }),
+		"reconnected by the watchdog"
+	) && ok;
+	ok = test::expect(device.subscribed && device.started, "subscription and acquisition restored") && ok;
+	return ok;
+}
+
+}
+
+int main()
+{
+	bool ok = true;
+	ok = _manual_reconnect_during_backoff() && ok;
+	ok = _automatic_reconnect() && ok;
+	fmt::print("supervisor: {}\n", ok ? "passed" : "failed");
+	return ok ? 0 : 1;
+}
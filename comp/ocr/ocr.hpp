@@ -26,6 +26,62 @@ namespace
 
 class model final
 {
+	// Optimisations for the CPU provider alone are cached next to the model, per onnxruntime version, and loaded
+	// while newer than it; CUDA takes nodes over when the session is created, hence is optimised on every start.
+	[[nodiscard]]
+	static inline Ort::Session _load_or_optimise(
+		const std::basic_string<ORTCHAR_T>& model_path,
+		Ort::Env& env,
+		Ort::SessionOptions& session_options
+	)
+	{
+		auto cache_path = std::filesystem::path(model_path);
+		cache_path += "." + std::string(Ort::GetVersionString()) + ".CPUExecutionProvider.ort";
+
+		std::error_code ec;
+		const auto cached = std::filesystem::last_write_time(cache_path, ec);
+		if (!ec && cached > std::filesystem::last_write_time(model_path, ec) && !ec)
+			try
+			{
+				auto cached_options = session_options.Clone();
+				cached_options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_DISABLE_ALL);
+				return { env, cache_path.c_str(), cached_options };
+			}
+			catch (const Ort::Exception&)
+			{
+				// damaged, it is optimised again below
+			}
+
+		// written aside, then renamed over the cache, so that no other process ever loads it half written
+		static thread_local std::mt19937_64 random { std::random_device {}() };
+		auto temporary_path = cache_path;
+		temporary_path += "." + std::to_string(random()) + ".tmp";
+		const bool writable = std::ofstream(temporary_path).good();
+		session_options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_EXTENDED);
+		if (writable)
+			session_options
+				.SetOptimizedModelFilePath(temporary_path.c_str())
+				.AddConfigEntry("session.save_model_format", "ORT");
+
+		try
+		{
+			Ort::Session ret { env, model_path.c_str(), session_options };
+			if (writable)
+			{
+				std::filesystem::rename(temporary_path, cache_path, ec);
+				if (ec)
+					std::filesystem::remove(temporary_path, ec);
+			}
+			return ret;
+		}
+		catch (...)
+		{
+			if (writable)
+				std::filesystem::remove(temporary_path, ec);
+			throw;
+		}
+	}
+
 	[[nodiscard]]
 	static inline Ort::Session _create_session(
 		const std::basic_string<ORTCHAR_T>& model_path,
@@ -40,6 +96,12 @@ class model final
 			.EnableMemPattern()
 			.DisableProfiling();
 
+		// built without CUDA, or without any usable device, the CPU provider is used alone
+		if (use_cuda)
+		{
+			const auto providers = Ort::GetAvailableProviders();
+			use_cuda = std::ranges::find(providers, "CUDAExecutionProvider") != providers.end();
+		}
 		if (use_cuda)
 		{
 			OrtCUDAProviderOptions cuda_options;
@@ -49,15 +111,21 @@ class model final
 			session_options.AppendExecutionProvider_CUDA(cuda_options);
 		}
 
+		if (!use_cuda)
+			return optimise ?
+				_load_or_optimise(model_path, env, session_options) :
+				Ort::Session { env, model_path.c_str(), session_options };
+
 		if (optimise)
+			session_options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_EXTENDED);
+		try
 		{
-			auto optimised_model_path = model_path + ORT_TSTR(".opt");
-			session_options
-				.SetOptimizedModelFilePath(optimised_model_path.c_str())
-				.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_EXTENDED);
+			return { env, model_path.c_str(), session_options };
+		}
+		catch (const Ort::Exception&)
+		{
+			return _create_session(model_path, env, false, optimise);
 		}
-
-		return { env, model_path.c_str(), session_options };
 	}
 
 	Ort::Env _env;
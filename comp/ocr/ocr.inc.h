@@ -3,10 +3,14 @@
 
 #include <algorithm>
 #include <concepts>
+#include <filesystem>
+#include <fstream>
 #include <memory>
+#include <random>
 #include <ranges>
 #include <stdexcept>
 #include <string>
+#include <system_error>
 #include <utility>
 #include <vector>
 
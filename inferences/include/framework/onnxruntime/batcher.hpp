@@ -0,0 +1,97 @@
+#ifndef INFERENCES_FRAMEWORK_ONNXRUNTIME_BATCHER_HPP
+#define INFERENCES_FRAMEWORK_ONNXRUNTIME_BATCHER_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <onnxruntime/core/session/onnxruntime_c_api.h>
+#include <onnxruntime/core/session/onnxruntime_cxx_api.h>
+
+#include "./model.hpp"
+
+namespace inferences::framework::onnxruntime
+{
+
+// Coalesces single samples submitted from any thread into batches, run one at a time on a worker thread of its own.
+// A batch is run once it is full, or once its oldest sample has waited for the maximum wait.
+// The model must take a single float input and give a single float output, both batched along their first dimension.
+// Tensors are kept for every batch size run so far, up to the maximum one, so that the steady state never allocates them.
+class batcher final
+{
+	struct request final
+	{
+		std::vector<float> input;
+		std::promise<std::vector<float>> output;
+		std::chrono::steady_clock::time_point submitted;
+	};
+
+	struct tensors final
+	{
+		Ort::Value input;
+		Ort::Value output;
+	};
+
+	model _model;
+	std::vector<int64_t> _input_shape, _output_shape;
+	size_t _input_size, _output_size;
+	// one pair per batch size, allocated by the first batch of that size and reused by the next ones
+	std::vector<tensors> _tensors;
+	// default options are created once, rather than on every run
+	Ort::RunOptions _run_options;
+	size_t _max_batch_size;
+	std::chrono::nanoseconds _max_wait;
+	size_t _batches, _samples;
+
+	std::mutex _mutex;
+	std::condition_variable _submitted;
+	std::deque<request> _requests;
+	bool _stopping;
+	std::thread _worker;
+
+	void _run(std::vector<request>& batch);
+
+	void _work();
+public:
+	// shapes of a single sample, without the batch dimension
+	batcher(
+		model&& model,
+		std::vector<int64_t> sample_input_shape,
+		std::vector<int64_t> sample_output_shape,
+		size_t max_batch_size,
+		const std::chrono::nanoseconds& max_wait
+	);
+
+	// runs the samples still queued before returning
+	~batcher() noexcept;
+
+	batcher(const batcher&) = delete;
+
+	batcher(batcher&&) = delete;
+
+	batcher& operator=(const batcher&) = delete;
+
+	batcher& operator=(batcher&&) = delete;
+
+	// run so far, along with the samples they held
+	[[nodiscard]]
+	size_t batches() &;
+
+	[[nodiscard]]
+	size_t samples() &;
+
+	// the sample input in row-major order, the future throwing if the run fails
+	[[nodiscard]]
+	std::future<std::vector<float>> submit(std::vector<float> input) &;
+};
+
+}
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef INFERENCES_FRAMEWORK_ONNXRUNTIME_ENVIRONMENT_HPP
+#define INFERENCES_FRAMEWORK_ONNXRUNTIME_ENVIRONMENT_HPP
+
+#include <cstddef>
+
+#include <memory>
+#include <optional>
+#include <string>
+
+#include <onnxruntime/core/session/onnxruntime_c_api.h>
+#include <onnxruntime/core/session/onnxruntime_cxx_api.h>
+
+namespace inferences::framework::onnxruntime
+{
+
+struct threading final
+{
+	// 0 lets onnxruntime choose, one thread per physical core for the intra-op pool
+	size_t intra_op_threads = 0;
+	// only used by sessions run in parallel execution mode
+	size_t inter_op_threads = 0;
+	// logical processors of each intra-op thread but the calling one, e.g. "1,2;3,4" or "1-2;3-4", empty leaving them unbound
+	std::string intra_op_affinity {};
+	// idle threads spin rather than sleep, trading CPU time for latency
+	bool spinning = true;
+	// every session runs on the thread pools of the environment, rather than on pools of its own
+	bool shared = true;
+
+	[[nodiscard]]
+	bool operator==(const threading&) const = default;
+};
+
+// The onnxruntime environment of the process, of which there is a single one alive at a time.
+// It is created by the first model and released with the last one, its threading being fixed in between.
+class environment final
+{
+	threading _threading;
+	Ort::Env _env;
+
+	explicit environment(const threading& threading);
+public:
+	// the environment alive, or a new one with the given threading, defaulted if none; throws if it conflicts
+	[[nodiscard]]
+	static std::shared_ptr<environment> instance(const std::optional<threading>& threading = std::nullopt);
+
+	environment(const environment&) = delete;
+
+	environment(environment&&) = delete;
+
+	~environment() noexcept;
+
+	environment& operator=(const environment&) = delete;
+
+	environment& operator=(environment&&) = delete;
+
+	// sets the threads of a session to be created in the environment
+	void configure(Ort::SessionOptions& options) const;
+
+	[[nodiscard]]
+	Ort::Env& env() noexcept;
+
+	[[nodiscard]]
+	const threading& settings() const noexcept;
+};
+
+}
+
+#endif
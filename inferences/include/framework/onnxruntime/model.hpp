@@ -4,23 +4,55 @@
 #include <cstddef>
 #include <cstdint>
 
+#include <memory>
+#include <optional>
 #include <ranges>
 #include <string>
+#include <vector>
 
 #include <onnxruntime/core/session/onnxruntime_c_api.h>
 #include <onnxruntime/core/session/onnxruntime_cxx_api.h>
 
+#include "./environment.hpp"
+#include "./provider.hpp"
+
 namespace inferences::framework::onnxruntime
 {
 
 class model final
 {
+	struct _slot final
+	{
+		std::vector<int64_t> shape;
+		ONNXTensorElementDataType type;
+		Ort::Value value;
+	};
+
 	static Ort::AllocatorWithDefaultOptions _allocator;
 
-	Ort::Env _env;
+	// outlives the session
+	std::shared_ptr<environment> _environment;
+	provider_report _providers;
 	Ort::Session _session;
 	std::vector<Ort::AllocatedStringPtr> _names;
 	std::vector<const char *> _input_names, _output_names;
+	// reallocated and bound again only when their shape or type changes
+	std::vector<_slot> _inputs, _outputs;
+	Ort::IoBinding _binding;
+	// default options are created once, rather than on every run
+	Ort::RunOptions _run_options;
+	// until the end of the first run, which tells where each node ran, if asked to
+	bool _profiling;
+
+	void _end_profiling();
+
+	Ort::Value& _bind(
+		bool input,
+		size_t index,
+		const int64_t *shape,
+		size_t shape_len,
+		ONNXTensorElementDataType type
+	);
 public:
 	template<typename T>
 	[[nodiscard]]
@@ -29,10 +61,18 @@ public:
 		return Ort::Value::CreateTensor<T>(_allocator, shape, shape_len);
 	}
 
+	// the options must not register providers of their own, the policy falling back to the CPU provider
+	// unless disabled, optimisations for the CPU provider alone are cached next to the model, per onnxruntime version,
+	// the providers finally registered being written to std::clog
+	// the threading applies to the environment of the process, see environment::instance
+	// reporting the provider of each node profiles the first run, which is slowed down by it
 	model(
 		const std::string& model_path,
 		const Ort::SessionOptions& common_options,
-		GraphOptimizationLevel graph_opt_level = GraphOptimizationLevel::ORT_ENABLE_EXTENDED
+		GraphOptimizationLevel graph_opt_level = GraphOptimizationLevel::ORT_ENABLE_EXTENDED,
+		provider_policy policy = provider_policy::AUTOMATIC,
+		const std::optional<threading>& threading = std::nullopt,
+		bool report_nodes = false
 	);
 
 	~model() noexcept;
@@ -45,6 +85,31 @@ public:
 
 	model& operator=(model&&) = delete;
 
+	[[nodiscard]]
+	const provider_report& providers() const noexcept;
+
+	// tensor owned by the model and bound to the given input, kept across runs as long as the shape is the same
+	template<typename T>
+	inline Ort::Value& input(size_t index, const int64_t *shape, size_t shape_len) &
+	{
+		return _bind(true, index, shape, shape_len, Ort::TypeToTensorType<T>::type);
+	}
+
+	// tensor owned by the model and bound to the given output, kept across runs as long as the shape is the same
+	template<typename T>
+	inline Ort::Value& output(size_t index, const int64_t *shape, size_t shape_len) &
+	{
+		return _bind(false, index, shape, shape_len, Ort::TypeToTensorType<T>::type);
+	}
+
+	// runs on the tensors returned by input and output, without allocating anything once they are all bound
+	void operator()(const Ort::RunOptions& run_options) &;
+
+	inline void operator()() &
+	{
+		operator()(_run_options);
+	}
+
 	void operator()(
 		const Ort::Value *inputs,
 		size_t input_num,
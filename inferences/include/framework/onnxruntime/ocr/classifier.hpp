@@ -3,6 +3,7 @@
 
 #include <cstddef>
 
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -48,12 +49,16 @@ public:
 	classifier(
 		const std::string& model_path,
 		const Ort::SessionOptions& options,
-		GraphOptimizationLevel graph_opt_level = GraphOptimizationLevel::ORT_ENABLE_EXTENDED
+		GraphOptimizationLevel graph_opt_level = GraphOptimizationLevel::ORT_ENABLE_EXTENDED,
+		provider_policy policy = provider_policy::AUTOMATIC,
+		const std::optional<threading>& threading = std::nullopt
 	);
 
 	classifier(
 		const std::string& model_path,
-		GraphOptimizationLevel graph_opt_level = GraphOptimizationLevel::ORT_ENABLE_EXTENDED
+		GraphOptimizationLevel graph_opt_level = GraphOptimizationLevel::ORT_ENABLE_EXTENDED,
+		provider_policy policy = provider_policy::AUTOMATIC,
+		const std::optional<threading>& threading = std::nullopt
 	);
 
 	~classifier() noexcept;
@@ -73,6 +78,9 @@ public:
 		const parameters& parameters
 	) &;
 
+	[[nodiscard]]
+	const provider_report& providers() const noexcept;
+
 	void warmup(const parameters& parameters) &;
 };
 
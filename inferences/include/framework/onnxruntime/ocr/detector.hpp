@@ -3,6 +3,7 @@
 
 #include <cstddef>
 
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -53,12 +54,16 @@ public:
 	detector(
 		const std::string& model_path,
 		const Ort::SessionOptions& options,
-		GraphOptimizationLevel graph_opt_level = GraphOptimizationLevel::ORT_ENABLE_EXTENDED
+		GraphOptimizationLevel graph_opt_level = GraphOptimizationLevel::ORT_ENABLE_EXTENDED,
+		provider_policy policy = provider_policy::AUTOMATIC,
+		const std::optional<threading>& threading = std::nullopt
 	);
 
 	detector(
 		const std::string& model_path,
-		GraphOptimizationLevel graph_opt_level = GraphOptimizationLevel::ORT_ENABLE_EXTENDED
+		GraphOptimizationLevel graph_opt_level = GraphOptimizationLevel::ORT_ENABLE_EXTENDED,
+		provider_policy policy = provider_policy::AUTOMATIC,
+		const std::optional<threading>& threading = std::nullopt
 	);
 
 	~detector() noexcept;
@@ -74,6 +79,9 @@ public:
 	[[nodiscard]]
 	std::vector<cv::RotatedRect> operator()(const cv::Mat& image, const parameters& parameters) &;
 
+	[[nodiscard]]
+	const provider_report& providers() const noexcept;
+
 	void warmup(const parameters& parameters) &;
 };
 
@@ -3,6 +3,7 @@
 
 #include <cstddef>
 
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -50,13 +51,17 @@ public:
 		const std::string& model_path,
 		const std::string& dictionary_path,
 		const Ort::SessionOptions& options,
-		GraphOptimizationLevel graph_opt_level = GraphOptimizationLevel::ORT_ENABLE_EXTENDED
+		GraphOptimizationLevel graph_opt_level = GraphOptimizationLevel::ORT_ENABLE_EXTENDED,
+		provider_policy policy = provider_policy::AUTOMATIC,
+		const std::optional<threading>& threading = std::nullopt
 	);
 
 	recogniser(
 		const std::string& model_path,
 		const std::string& dictionary_path,
-		GraphOptimizationLevel graph_opt_level = GraphOptimizationLevel::ORT_ENABLE_EXTENDED
+		GraphOptimizationLevel graph_opt_level = GraphOptimizationLevel::ORT_ENABLE_EXTENDED,
+		provider_policy policy = provider_policy::AUTOMATIC,
+		const std::optional<threading>& threading = std::nullopt
 	);
 
 	~recogniser() noexcept;
@@ -75,6 +80,9 @@ public:
 		const parameters& parameters
 	) &;
 
+	[[nodiscard]]
+	const provider_report& providers() const noexcept;
+
 	void warmup(const parameters& parameters) &;
 };
 
@@ -0,0 +1,46 @@
+#ifndef INFERENCES_FRAMEWORK_ONNXRUNTIME_PROVIDER_HPP
+#define INFERENCES_FRAMEWORK_ONNXRUNTIME_PROVIDER_HPP
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <onnxruntime/core/session/onnxruntime_c_api.h>
+#include <onnxruntime/core/session/onnxruntime_cxx_api.h>
+
+namespace inferences::framework::onnxruntime
+{
+
+enum class provider_policy
+{
+	// the default CPU provider alone
+	CPU,
+	// oneDNN, or else XNNPACK, ahead of the CPU provider, whichever onnxruntime is built with
+	OPTIMISED_CPU,
+	// CUDA ahead of the CPU provider
+	CUDA,
+	// CUDA if a device is usable, the optimised CPU providers otherwise
+	AUTOMATIC
+};
+
+struct provider_report final
+{
+	// registered with the session ahead of the CPU provider, empty meaning the CPU provider alone
+	std::vector<std::string> providers;
+	// of the providers tried before, in order, each falling back to the next ones
+	std::vector<std::string> failures;
+	// provider each node ran on, filled by the first run of a model reporting its nodes
+	std::unordered_map<std::string, std::string> nodes;
+};
+
+// Sets of providers to try in order for a policy, those onnxruntime is not built with left out.
+// The last set is always the CPU provider alone.
+[[nodiscard]]
+std::vector<std::vector<std::string>> provider_candidates(provider_policy policy);
+
+// providers as named by Ort::GetAvailableProviders
+void append_providers(Ort::SessionOptions& options, const std::vector<std::string>& providers);
+
+}
+
+#endif
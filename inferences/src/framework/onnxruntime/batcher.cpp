@@ -0,0 +1,197 @@
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <onnxruntime/core/session/onnxruntime_c_api.h>
+#include <onnxruntime/core/session/onnxruntime_cxx_api.h>
+
+#include "framework/onnxruntime/batcher.hpp"
+#include "framework/onnxruntime/model.hpp"
+
+namespace inferences::framework::onnxruntime
+{
+
+namespace
+{
+
+[[nodiscard]]
+inline static size_t _sample_size(const std::vector<int64_t>& shape)
+{
+	return std::accumulate(shape.begin(), shape.end(), size_t(1), std::multiplies<size_t>());
+}
+
+}
+
+void batcher::_run(std::vector<request>& batch)
+{
+	try
+	{
+		auto& tensors = _tensors[batch.size() - 1];
+		if (!tensors.input)
+		[[unlikely]]
+		{
+			// the batch dimension comes first
+			_input_shape.front() = _output_shape.front() = static_cast<int64_t>(batch.size());
+			tensors.input = model::tensor<float>(_input_shape.data(), _input_shape.size());
+			tensors.output = model::tensor<float>(_output_shape.data(), _output_shape.size());
+		}
+
+		auto write_ptr = tensors.input.GetTensorMutableData<float>();
+		for (size_t i = 0; i < batch.size(); ++i)
+			std::copy(batch[i].input.begin(), batch[i].input.end(), write_ptr + i * _input_size);
+
+		_model(tensors.input, tensors.output, _run_options);
+
+		auto read_ptr = tensors.output.GetTensorData<float>();
+		for (size_t i = 0; i < batch.size(); ++i)
+			batch[i].output.set_value({ read_ptr + i * _output_size, read_ptr + (i + 1) * _output_size });
+	}
+	catch (...)
+	{
+		const auto exception = std::current_exception();
+		for (auto& request : batch)
+			try
+			{
+				request.output.set_exception(exception);
+			}
+			catch (const std::future_error&)
+			{
+				// already given its output before the failure
+			}
+	}
+}
+
+void batcher::_work()
+{
+	std::vector<request> batch;
+	batch.reserve(_max_batch_size);
+
+	std::unique_lock lock(_mutex);
+	while (true)
+	{
+		_submitted.wait(lock, [this] { return _stopping || !_requests.empty(); });
+		if (_requests.empty())
+			return;
+
+		// the queue is drained without waiting once stopping
+		const auto deadline = _requests.front().submitted + _max_wait;
+		_submitted.wait_until(lock, deadline, [this] { return _stopping || _requests.size() >= _max_batch_size; });
+
+		const auto count = std::min(_requests.size(), _max_batch_size);
+		for (size_t i = 0; i < count; ++i)
+		{
+			batch.push_back(std::move(_requests.front()));
+			_requests.pop_front();
+		}
+
+		lock.unlock();
+		_run(batch);
+		lock.lock();
+
+		++_batches;
+		_samples += batch.size();
+		batch.clear();
+	}
+}
+
+batcher::batcher(
+	model&& model,
+	std::vector<int64_t> sample_input_shape,
+	std::vector<int64_t> sample_output_shape,
+	size_t max_batch_size,
+	const std::chrono::nanoseconds& max_wait
+) :
+	_model(std::move(model)),
+	_input_shape(),
+	_output_shape(),
+	_input_size(_sample_size(sample_input_shape)),
+	_output_size(_sample_size(sample_output_shape)),
+	_tensors(),
+	_run_options(),
+	_max_batch_size(max_batch_size),
+	_max_wait(max_wait),
+	_batches(0),
+	_samples(0),
+	_mutex(),
+	_submitted(),
+	_requests(),
+	_stopping(false),
+	_worker()
+{
+	if (!_max_batch_size)
+	[[unlikely]]
+		throw std::invalid_argument("batch size must be positive");
+
+	_input_shape.reserve(sample_input_shape.size() + 1);
+	_input_shape.push_back(0);
+	_input_shape.insert(_input_shape.end(), sample_input_shape.begin(), sample_input_shape.end());
+	_output_shape.reserve(sample_output_shape.size() + 1);
+	_output_shape.push_back(0);
+	_output_shape.insert(_output_shape.end(), sample_output_shape.begin(), sample_output_shape.end());
+	_tensors.reserve(_max_batch_size);
+	for (size_t i = 0; i < _max_batch_size; ++i)
+		_tensors.push_back({ Ort::Value(nullptr), Ort::Value(nullptr) });
+
+	_worker = std::thread(&batcher::_work, this);
+}
+
+batcher::~batcher() noexcept
+{
+	{
+		std::lock_guard lock(_mutex);
+		_stopping = true;
+	}
+	_submitted.notify_one();
+	if (_worker.joinable())
+		_worker.join();
+}
+
+[[nodiscard]]
+size_t batcher::batches() &
+{
+	std::lock_guard lock(_mutex);
+	return _batches;
+}
+
+[[nodiscard]]
+size_t batcher::samples() &
+{
+	std::lock_guard lock(_mutex);
+	return _samples;
+}
+
+[[nodiscard]]
+std::future<std::vector<float>> batcher::submit(std::vector<float> input) &
+{
+	if (input.size() != _input_size)
+	[[unlikely]]
+		throw std::invalid_argument("sample input size mismatch");
+
+	std::future<std::vector<float>> ret;
+	bool wake;
+	{
+		std::lock_guard lock(_mutex);
+		auto& request = _requests.emplace_back();
+		request.input = std::move(input);
+		request.submitted = std::chrono::steady_clock::now();
+		ret = request.output.get_future();
+		// the worker only needs waking up for the first sample of a batch, or the one filling it
+		wake = _requests.size() == 1 || _requests.size() >= _max_batch_size;
+	}
+	if (wake)
+		_submitted.notify_one();
+	return ret;
+}
+
+}
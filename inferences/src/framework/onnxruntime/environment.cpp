@@ -0,0 +1,90 @@
+#include <cstddef>
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+#include <onnxruntime/core/session/onnxruntime_c_api.h>
+#include <onnxruntime/core/session/onnxruntime_cxx_api.h>
+
+#include "framework/onnxruntime/environment.hpp"
+
+namespace inferences::framework::onnxruntime
+{
+
+namespace
+{
+
+[[nodiscard]]
+inline static Ort::Env _create_env(const threading& threading)
+{
+	if (!threading.shared)
+		return {};
+
+	Ort::ThreadingOptions options;
+	options
+		.SetGlobalIntraOpNumThreads(static_cast<int>(threading.intra_op_threads))
+		.SetGlobalInterOpNumThreads(static_cast<int>(threading.inter_op_threads))
+		.SetGlobalSpinControl(threading.spinning);
+	if (!threading.intra_op_affinity.empty())
+		Ort::ThrowOnError(Ort::GetApi().SetGlobalIntraOpThreadAffinity(options, threading.intra_op_affinity.c_str()));
+	return Ort::Env(options);
+}
+
+static std::mutex _instance_mutex;
+static std::weak_ptr<environment> _instance;
+
+}
+
+environment::environment(const threading& threading) : _threading(threading), _env(_create_env(threading)) {}
+
+[[nodiscard]]
+std::shared_ptr<environment> environment::instance(const std::optional<threading>& threading)
+{
+	std::lock_guard lock(_instance_mutex);
+	if (auto ret = _instance.lock())
+	{
+		if (threading && *threading != ret->_threading)
+		[[unlikely]]
+			throw std::logic_error("onnxruntime environment already alive with another threading");
+		return ret;
+	}
+
+	std::shared_ptr<environment> ret(new environment(threading.value_or(onnxruntime::threading {})));
+	_instance = ret;
+	return ret;
+}
+
+environment::~environment() noexcept = default;
+
+void environment::configure(Ort::SessionOptions& options) const
+{
+	if (_threading.shared)
+	{
+		options.DisablePerSessionThreads();
+		return;
+	}
+
+	options
+		.SetIntraOpNumThreads(static_cast<int>(_threading.intra_op_threads))
+		.SetInterOpNumThreads(static_cast<int>(_threading.inter_op_threads))
+		.AddConfigEntry("session.intra_op.allow_spinning", _threading.spinning ? "1" : "0");
+	if (!_threading.intra_op_affinity.empty())
+		options.AddConfigEntry("session.intra_op_thread_affinities", _threading.intra_op_affinity.c_str());
+}
+
+[[nodiscard]]
+Ort::Env& environment::env() noexcept
+{
+	return _env;
+}
+
+[[nodiscard]]
+const threading& environment::settings() const noexcept
+{
+	return _threading;
+}
+
+}
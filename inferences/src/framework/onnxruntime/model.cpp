@@ -1,12 +1,25 @@
 #include <cstddef>
+#include <cstdint>
 
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <random>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
 
+#include <nlohmann/json.hpp>
 #include <onnxruntime/core/session/onnxruntime_c_api.h>
 #include <onnxruntime/core/session/onnxruntime_cxx_api.h>
 
+#include "framework/onnxruntime/environment.hpp"
 #include "framework/onnxruntime/model.hpp"
+#include "framework/onnxruntime/provider.hpp"
 
 namespace inferences::framework::onnxruntime
 {
@@ -14,25 +27,140 @@ namespace inferences::framework::onnxruntime
 namespace
 {
 
+// optimisations depend on the version of onnxruntime, hence a cache per version
+[[nodiscard]]
+inline static std::string _cache_path(const std::string& model_path)
+{
+	return model_path + '.' + Ort::GetVersionString() + ".CPUExecutionProvider.ort";
+}
+
+[[nodiscard]]
+inline static bool _fresh(const std::string& cache_path, const std::string& model_path)
+{
+	std::error_code ec;
+	const auto cached = std::filesystem::last_write_time(cache_path, ec);
+	if (ec)
+		return false;
+	const auto source = std::filesystem::last_write_time(model_path, ec);
+	return !ec && cached > source;
+}
+
+[[nodiscard]]
+inline static Ort::Session _load_or_optimise(
+	const std::string& model_path,
+	environment& environment,
+	Ort::SessionOptions& session_options,
+	GraphOptimizationLevel graph_opt_level,
+	const std::vector<std::string>& providers
+)
+{
+	if (graph_opt_level == GraphOptimizationLevel::ORT_DISABLE_ALL)
+	[[unlikely]]
+		return { environment.env(), model_path.c_str(), session_options };
+
+	// oneDNN, XNNPACK and CUDA take nodes over when the session is created, which an ORT format model
+	// saved with them would have to replay, so only the CPU provider alone gets a cache
+	if (!providers.empty())
+	{
+		session_options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_EXTENDED);
+		return { environment.env(), model_path.c_str(), session_options };
+	}
+
+	const auto cache_path = _cache_path(model_path);
+	if (_fresh(cache_path, model_path))
+		try
+		{
+			auto cached_options = session_options.Clone();
+			cached_options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_DISABLE_ALL);
+			return { environment.env(), cache_path.c_str(), cached_options };
+		}
+		catch (const Ort::Exception&)
+		{
+			// damaged, it is optimised again below
+		}
+
+	// written aside, then renamed over the cache, so that no other process ever loads it half written
+	static thread_local std::mt19937_64 random { std::random_device {}() };
+	const auto temporary_path = cache_path + '.' + std::to_string(random()) + ".tmp";
+	const bool writable = std::ofstream(temporary_path).good();
+	session_options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_EXTENDED);
+	if (writable)
+	[[likely]]
+		session_options
+			.SetOptimizedModelFilePath(temporary_path.c_str())
+			.AddConfigEntry("session.save_model_format", "ORT");
+
+	std::error_code ec;
+	try
+	{
+		Ort::Session ret { environment.env(), model_path.c_str(), session_options };
+		if (writable)
+		[[likely]]
+		{
+			std::filesystem::rename(temporary_path, cache_path, ec);
+			if (ec)
+				std::filesystem::remove(temporary_path, ec);
+		}
+		return ret;
+	}
+	catch (...)
+	{
+		if (writable)
+			std::filesystem::remove(temporary_path, ec);
+		throw;
+	}
+}
+
+inline static void _log_providers(const std::string& model_path, const provider_report& report)
+{
+	std::string line = model_path + ": running on ";
+	for (const auto& provider : report.providers)
+		(line += provider) += ", ";
+	line += "CPUExecutionProvider";
+	for (const auto& failure : report.failures)
+		(line += "; skipped ") += failure;
+	std::clog << line << std::endl;
+}
+
 [[nodiscard]]
 inline static Ort::Session _create_session(
 	const std::string& model_path,
-	Ort::Env& env,
+	environment& environment,
 	const Ort::SessionOptions& common_options,
-	GraphOptimizationLevel graph_opt_level
+	GraphOptimizationLevel graph_opt_level,
+	provider_policy policy,
+	bool report_nodes,
+	provider_report& report
 )
 {
-	if (graph_opt_level > GraphOptimizationLevel::ORT_DISABLE_ALL)
-	[[likely]]
+	// the profile of the first run lands in the temporary directory, and is removed once read
+	const auto profile_prefix = (
+		std::filesystem::temp_directory_path() / std::filesystem::path(model_path).filename()
+	).string();
+
+	for (const auto& candidate : provider_candidates(policy))
 	{
-		auto optimised_model_path = model_path + ".opt";
-		auto session_options = common_options.Clone();
-		session_options
-			.SetOptimizedModelFilePath(optimised_model_path.c_str())
-			.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_EXTENDED);
-		return { env, model_path.c_str(), session_options };
+		try
+		{
+			auto session_options = common_options.Clone();
+			environment.configure(session_options);
+			append_providers(session_options, candidate);
+			if (report_nodes)
+				session_options.EnableProfiling(profile_prefix.c_str());
+			auto ret = _load_or_optimise(model_path, environment, session_options, graph_opt_level, candidate);
+			report.providers = candidate;
+			_log_providers(model_path, report);
+			return ret;
+		}
+		catch (const Ort::Exception& e)
+		{
+			// the CPU provider alone failing is not a matter of providers
+			if (candidate.empty())
+				throw;
+			report.failures.push_back(candidate.front() + ": " + e.what());
+		}
 	}
-	return { env, model_path.c_str(), common_options };
+	throw std::logic_error("no execution provider left to fall back to");
 }
 
 }
@@ -42,13 +170,22 @@ Ort::AllocatorWithDefaultOptions model::_allocator;
 model::model(
 	const std::string& model_path,
 	const Ort::SessionOptions& common_options,
-	GraphOptimizationLevel graph_opt_level
+	GraphOptimizationLevel graph_opt_level,
+	provider_policy policy,
+	const std::optional<threading>& threading,
+	bool report_nodes
 ) :
-	_env(),
-	_session(_create_session(model_path, _env, common_options, graph_opt_level)),
+	_environment(environment::instance(threading)),
+	_providers(),
+	_session(_create_session(model_path, *_environment, common_options, graph_opt_level, policy, report_nodes, _providers)),
 	_names(),
 	_input_names(),
-	_output_names()
+	_output_names(),
+	_inputs(),
+	_outputs(),
+	_binding(_session),
+	_run_options(),
+	_profiling(report_nodes)
 {
 	auto input_num = _session.GetInputCount(), output_num = _session.GetOutputCount();
 
@@ -63,12 +200,101 @@ model::model(
 		_output_names.emplace_back(
 			_names.emplace_back(_session.GetOutputNameAllocated(i, _allocator)).get()
 		);
+
+	_inputs.reserve(input_num);
+	for (size_t i = 0; i < input_num; ++i)
+		_inputs.push_back({ {}, ONNX_TENSOR_ELEMENT_DATA_TYPE_UNDEFINED, Ort::Value(nullptr) });
+	_outputs.reserve(output_num);
+	for (size_t i = 0; i < output_num; ++i)
+		_outputs.push_back({ {}, ONNX_TENSOR_ELEMENT_DATA_TYPE_UNDEFINED, Ort::Value(nullptr) });
 }
 
 model::~model() noexcept = default;
 
 model::model(model&&) noexcept = default;
 
+void model::_end_profiling()
+{
+	_profiling = false;
+	const auto profile_path = _session.EndProfilingAllocated(_allocator);
+
+	nlohmann::json events;
+	{
+		std::ifstream profile(profile_path.get());
+		events = nlohmann::json::parse(profile, nullptr, false);
+	}
+	std::error_code ec;
+	std::filesystem::remove(profile_path.get(), ec);
+	if (!events.is_array())
+	[[unlikely]]
+		return;
+
+	static constexpr std::string_view kernel_suffix = "_kernel_time";
+	for (const auto& event : events)
+	{
+		if (event.value("cat", "") != "Node")
+			continue;
+		const auto args = event.find("args");
+		if (args == event.end() || !args->contains("provider"))
+			continue;
+		auto name = event.value("name", std::string());
+		if (name.ends_with(kernel_suffix))
+			name.resize(name.size() - kernel_suffix.size());
+		_providers.nodes.insert_or_assign(std::move(name), (*args)["provider"].get<std::string>());
+	}
+}
+
+[[nodiscard]]
+const provider_report& model::providers() const noexcept
+{
+	return _providers;
+}
+
+Ort::Value& model::_bind(
+	bool input,
+	size_t index,
+	const int64_t *shape,
+	size_t shape_len,
+	ONNXTensorElementDataType type
+)
+{
+	auto& slots = input ? _inputs : _outputs;
+	if (index >= slots.size())
+	[[unlikely]]
+		throw std::out_of_range(input ? "model input index out of range" : "model output index out of range");
+
+	auto& slot = slots[index];
+	if (slot.type == type && std::equal(shape, shape + shape_len, slot.shape.begin(), slot.shape.end()))
+	[[likely]]
+		return slot.value;
+
+	slot.shape.assign(shape, shape + shape_len);
+	slot.type = type;
+	slot.value = Ort::Value::CreateTensor(_allocator, shape, shape_len, type);
+	if (input)
+		_binding.BindInput(_input_names[index], slot.value);
+	else
+		_binding.BindOutput(_output_names[index], slot.value);
+	return slot.value;
+}
+
+void model::operator()(const Ort::RunOptions& run_options) &
+{
+	for (const auto& slot : _inputs)
+		if (!slot.value)
+		[[unlikely]]
+			throw std::runtime_error("model input not bound");
+	for (const auto& slot : _outputs)
+		if (!slot.value)
+		[[unlikely]]
+			throw std::runtime_error("model output not bound");
+
+	_session.Run(run_options, _binding);
+	if (_profiling)
+	[[unlikely]]
+		_end_profiling();
+}
+
 void model::operator()(
 	const Ort::Value *inputs,
 	size_t input_num,
@@ -85,6 +311,9 @@ void model::operator()(
 		throw std::runtime_error("model output number mismatch");
 
 	_session.Run(run_options, _input_names.data(), inputs, input_num, _output_names.data(), outputs, output_num);
+	if (_profiling)
+	[[unlikely]]
+		_end_profiling();
 }
 
 }
@@ -1,5 +1,6 @@
 #include <cstddef>
 
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -61,13 +62,17 @@ classifier::parameters& classifier::parameters::operator=(parameters&&) noexcept
 classifier::classifier(
 	const std::string& model_path,
 	const Ort::SessionOptions& options,
-	GraphOptimizationLevel graph_opt_level
-) : _model(model_path, options, graph_opt_level) {}
+	GraphOptimizationLevel graph_opt_level,
+	provider_policy policy,
+	const std::optional<threading>& threading
+) : _model(model_path, options, graph_opt_level, policy, threading) {}
 
 classifier::classifier(
 	const std::string& model_path,
-	GraphOptimizationLevel graph_opt_level
-) : classifier(model_path, _GLOBAL_DEFAULT_OPTIONS, graph_opt_level) {}
+	GraphOptimizationLevel graph_opt_level,
+	provider_policy policy,
+	const std::optional<threading>& threading
+) : classifier(model_path, _GLOBAL_DEFAULT_OPTIONS, graph_opt_level, policy, threading) {}
 
 classifier::~classifier() noexcept = default;
 
@@ -85,9 +90,9 @@ std::vector<cv::Mat> classifier::operator()(
 		_crop_box(image, boxes[i], results[i]);
 
 	int64_t input_shape[] { parameters.batch_size, 3, parameters.shape.height, parameters.shape.width };
-	auto input_tensor = model::tensor<float>(input_shape, 4);
+	auto& input_tensor = _model.input<float>(0, input_shape, 4);
 	int64_t output_shape[] { parameters.batch_size, 2 };
-	auto output_tensor = model::tensor<float>(output_shape, 2);
+	auto& output_tensor = _model.output<float>(0, output_shape, 2);
 
 	size_t stride = parameters.shape.area() * 3;
 	for (size_t i = 0; i < results.size(); i += parameters.batch_size)
@@ -103,7 +108,7 @@ std::vector<cv::Mat> classifier::operator()(
 				write_ptr + j * stride
 			);
 
-		_model(input_tensor, output_tensor);
+		_model();
 
 		auto read_ptr = output_tensor.GetTensorData<float>();
 		for (size_t j = 0; j < left; ++j)
@@ -120,13 +125,19 @@ std::vector<cv::Mat> classifier::operator()(
 	return results;
 }
 
+[[nodiscard]]
+const provider_report& classifier::providers() const noexcept
+{
+	return _model.providers();
+}
+
 void classifier::warmup(const parameters& parameters) &
 {
 	int64_t input_shape[] { parameters.batch_size, 3, parameters.shape.height, parameters.shape.width };
-	auto input_tensor = model::tensor<float>(input_shape, 4);
+	_model.input<float>(0, input_shape, 4);
 	int64_t output_shape[] { parameters.batch_size, 2 };
-	auto output_tensor = model::tensor<float>(output_shape, 2);
-	_model(input_tensor, output_tensor);
+	_model.output<float>(0, output_shape, 2);
+	_model();
 }
 
 }
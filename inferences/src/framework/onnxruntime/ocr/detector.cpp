@@ -1,5 +1,6 @@
 #include <cstddef>
 
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -144,13 +145,17 @@ detector::parameters& detector::parameters::operator=(parameters&&) noexcept = d
 detector::detector(
 	const std::string& model_path,
 	const Ort::SessionOptions& options,
-	GraphOptimizationLevel graph_opt_level
-) : _model(model_path, options, graph_opt_level) {}
+	GraphOptimizationLevel graph_opt_level,
+	provider_policy policy,
+	const std::optional<threading>& threading
+) : _model(model_path, options, graph_opt_level, policy, threading) {}
 
 detector::detector(
 	const std::string& model_path,
-	GraphOptimizationLevel graph_opt_level
-) : detector(model_path, _GLOBAL_DEFAULT_OPTIONS, graph_opt_level) {}
+	GraphOptimizationLevel graph_opt_level,
+	provider_policy policy,
+	const std::optional<threading>& threading
+) : detector(model_path, _GLOBAL_DEFAULT_OPTIONS, graph_opt_level, policy, threading) {}
 
 detector::~detector() noexcept = default;
 
@@ -160,7 +165,7 @@ detector::detector(detector&&) noexcept = default;
 std::vector<cv::RotatedRect> detector::operator()(const cv::Mat& image, const parameters& parameters) &
 {
 	int64_t input_shape[] { 1, 3, parameters.shape.height, parameters.shape.width };
-	auto input_tensor = model::tensor<float>(input_shape, 4);
+	auto& input_tensor = _model.input<float>(0, input_shape, 4);
 	auto scaler = _scale_split_image(
 		image,
 		parameters.shape,
@@ -169,9 +174,9 @@ std::vector<cv::RotatedRect> detector::operator()(const cv::Mat& image, const pa
 		input_tensor.GetTensorMutableData<float>()
 	);
 	int64_t output_shape[] { 1, 1, parameters.shape.height, parameters.shape.width };
-	auto output_tensor = model::tensor<float>(output_shape, 4);
+	auto& output_tensor = _model.output<float>(0, output_shape, 4);
 
-	_model(input_tensor, output_tensor);
+	_model();
 
 	cv::Mat scores(parameters.shape, CV_32FC1, output_tensor.GetTensorMutableData<float>());
 	std::vector<std::vector<cv::Point>> contours;
@@ -194,13 +199,19 @@ std::vector<cv::RotatedRect> detector::operator()(const cv::Mat& image, const pa
 	return results;
 }
 
+[[nodiscard]]
+const provider_report& detector::providers() const noexcept
+{
+	return _model.providers();
+}
+
 void detector::warmup(const parameters& parameters) &
 {
 	int64_t input_shape[] { 1, 3, parameters.shape.height, parameters.shape.width };
-	auto input_tensor = model::tensor<float>(input_shape, 4);
+	_model.input<float>(0, input_shape, 4);
 	int64_t output_shape[] { 1, 1, parameters.shape.height, parameters.shape.width };
-	auto output_tensor = model::tensor<float>(output_shape, 4);
-	_model(input_tensor, output_tensor);
+	_model.output<float>(0, output_shape, 4);
+	_model();
 }
 
 }
@@ -1,5 +1,6 @@
 #include <cstddef>
 
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -38,8 +39,10 @@ recogniser::recogniser(
 	const std::string& model_path,
 	const std::string& dictionary_path,
 	const Ort::SessionOptions& options,
-	GraphOptimizationLevel graph_opt_level
-) : _model(model_path, options, graph_opt_level), _dictionary()
+	GraphOptimizationLevel graph_opt_level,
+	provider_policy policy,
+	const std::optional<threading>& threading
+) : _model(model_path, options, graph_opt_level, policy, threading), _dictionary()
 {
 	mio::mmap_source dict(dictionary_path);
 	std::vector<char> buffer;
@@ -71,8 +74,10 @@ recogniser::recogniser(
 recogniser::recogniser(
 	const std::string& model_path,
 	const std::string& dictionary_path,
-	GraphOptimizationLevel graph_opt_level
-) : recogniser(model_path, dictionary_path, _GLOBAL_DEFAULT_OPTIONS, graph_opt_level) {}
+	GraphOptimizationLevel graph_opt_level,
+	provider_policy policy,
+	const std::optional<threading>& threading
+) : recogniser(model_path, dictionary_path, _GLOBAL_DEFAULT_OPTIONS, graph_opt_level, policy, threading) {}
 
 recogniser::~recogniser() noexcept = default;
 
@@ -88,9 +93,9 @@ std::vector<std::tuple<size_t, std::string, double>> recogniser::operator()(
 	results.reserve(fragments.size());
 
 	int64_t input_shape[] { parameters.batch_size, 3, parameters.shape.height, parameters.shape.width };
-	auto input_tensor = model::tensor<float>(input_shape, 4);
+	auto& input_tensor = _model.input<float>(0, input_shape, 4);
 	int64_t output_shape[] { parameters.batch_size, 40, _dictionary.size() + 1 };
-	auto output_tensor = model::tensor<float>(output_shape, 3);
+	auto& output_tensor = _model.output<float>(0, output_shape, 3);
 
 	size_t input_stride = parameters.shape.area() * 3, output_stride = (_dictionary.size() + 1) * 40;
 	for (size_t i = 0; i < fragments.size(); i += parameters.batch_size)
@@ -106,7 +111,7 @@ std::vector<std::tuple<size_t, std::string, double>> recogniser::operator()(
 				write_ptr + j * input_stride
 			);
 
-		_model(input_tensor, output_tensor);
+		_model();
 
 		auto read_ptr = output_tensor.GetTensorData<float>();
 		for (size_t j = 0; j < left; ++j)
@@ -150,13 +155,19 @@ std::vector<std::tuple<size_t, std::string, double>> recogniser::operator()(
 	return results;
 }
 
+[[nodiscard]]
+const provider_report& recogniser::providers() const noexcept
+{
+	return _model.providers();
+}
+
 void recogniser::warmup(const parameters& parameters) &
 {
 	int64_t input_shape[] { parameters.batch_size, 3, parameters.shape.height, parameters.shape.width };
-	auto input_tensor = model::tensor<float>(input_shape, 4);
+	_model.input<float>(0, input_shape, 4);
 	int64_t output_shape[] { parameters.batch_size, 40, _dictionary.size() + 1 };
-	auto output_tensor = model::tensor<float>(output_shape, 3);
-	_model(input_tensor, output_tensor);
+	_model.output<float>(0, output_shape, 3);
+	_model();
 }
 
 }
@@ -18,13 +18,12 @@ namespace
 [[nodiscard]]
 inline static auto _default_options() noexcept
 {
+	// providers are appended by the model, following its policy
 	Ort::SessionOptions session_options;
-	OrtCUDAProviderOptions cuda_provider_options;
 	session_options
 		.EnableCpuMemArena()
 		.EnableMemPattern()
-		.DisableProfiling()
-		.AppendExecutionProvider_CUDA(cuda_provider_options);
+		.DisableProfiling();
 	return session_options;
 }
 
@@ -0,0 +1,70 @@
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <onnxruntime/core/session/onnxruntime_c_api.h>
+#include <onnxruntime/core/session/onnxruntime_cxx_api.h>
+
+#include "framework/onnxruntime/provider.hpp"
+
+namespace inferences::framework::onnxruntime
+{
+
+namespace
+{
+
+static constexpr auto _CUDA = "CUDAExecutionProvider";
+static constexpr auto _DNNL = "DnnlExecutionProvider";
+static constexpr auto _XNNPACK = "XnnpackExecutionProvider";
+
+}
+
+[[nodiscard]]
+std::vector<std::vector<std::string>> provider_candidates(provider_policy policy)
+{
+	const auto available = Ort::GetAvailableProviders();
+	const auto has = [&](const char *provider)
+	{
+		return std::find(available.begin(), available.end(), provider) != available.end();
+	};
+
+	std::vector<std::vector<std::string>> ret;
+	if ((policy == provider_policy::CUDA || policy == provider_policy::AUTOMATIC) && has(_CUDA))
+		ret.push_back({ _CUDA });
+	if (policy == provider_policy::OPTIMISED_CPU || policy == provider_policy::AUTOMATIC)
+	{
+		if (has(_DNNL))
+			ret.push_back({ _DNNL });
+		if (has(_XNNPACK))
+			ret.push_back({ _XNNPACK });
+	}
+	ret.emplace_back();
+	return ret;
+}
+
+void append_providers(Ort::SessionOptions& options, const std::vector<std::string>& providers)
+{
+	for (const auto& provider : providers)
+		if (provider == _CUDA)
+		{
+			OrtCUDAProviderOptions cuda_provider_options;
+			options.AppendExecutionProvider_CUDA(cuda_provider_options);
+		}
+		else if (provider == _DNNL)
+		{
+			const auto& api = Ort::GetApi();
+			OrtDnnlProviderOptions *dnnl_provider_options = nullptr;
+			Ort::ThrowOnError(api.CreateDnnlProviderOptions(&dnnl_provider_options));
+			auto status = api.SessionOptionsAppendExecutionProvider_Dnnl(options, dnnl_provider_options);
+			api.ReleaseDnnlProviderOptions(dnnl_provider_options);
+			Ort::ThrowOnError(status);
+		}
+		else if (provider == _XNNPACK)
+			options.AppendExecutionProvider("XNNPACK");
+		else
+		[[unlikely]]
+			throw std::invalid_argument("unsupported execution provider " + provider);
+}
+
+}